@@ -0,0 +1,33 @@
+#pragma once
+// Sprite sheet layout and player animation tables.
+#include <SFML/Graphics.hpp>
+#include <map>
+
+// --- Animation Constants ---
+const int FRAME_WIDTH = 64;               // Frame width in pixels
+const int FRAME_HEIGHT = 64;              // Frame height in pixels
+const int FRAMES_PER_ROW = 8;             // Number of frames per row in sprite sheet
+const float STATE_CHANGE_COOLDOWN = 0.1f; // Cooldown time between state changes (Optional)
+
+// Animation state definitions
+enum class PlayerAnimState
+{
+    Stand, // Stand animation
+    Walk,  // Walk animation
+    Jump,  // Jump and Fall animation
+    Stance // Combat stance (currently unused)
+};
+
+// Animation data structure (start index, frame count, time per frame)
+struct AnimationData
+{
+    int startFrameIndex; // Starting frame index in the sheet (0-based)
+    int frameCount;      // Total number of frames for this animation
+    float timePerFrame;  // Time per frame in seconds
+};
+
+// Animation table shared by the local and remote players
+const std::map<PlayerAnimState, AnimationData> &playerAnimations();
+
+// Texture rect of the given frame of an animation in the sprite sheet
+sf::IntRect animationFrameRect(const AnimationData &data, int frame);
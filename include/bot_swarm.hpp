@@ -0,0 +1,20 @@
+#pragma once
+// Headless bot clients for load testing. Every bot connects like a player and
+// walks, falls and jumps between random goals along the navigation graph of
+// the map the server sends, so the server sees realistic input traffic.
+#include <SFML/Network.hpp>
+#include <cstdint>
+#include <string>
+
+struct BotOptions
+{
+    uint32_t count = 100;
+    sf::IpAddress address = sf::IpAddress::LocalHost;
+    unsigned short port = 53000;
+    float durationSeconds = 0.f;           // 0 = until interrupted
+    std::string cacheDirectory = "navcache"; // Navigation graphs by map hash
+    uint32_t seed = 1;
+};
+
+// Returns the process exit code (1 if no bot ever got a map to navigate)
+int runBotSwarm(const BotOptions &options);
@@ -0,0 +1,72 @@
+#pragma once
+// Bulk codec for arrays in sf::Packet's wire format. Multi-byte integers go
+// over the wire big-endian, like sf::Packet's own operators; floats and bools
+// keep sf::Packet's encoding. Arrays are converted in one pass (SIMD byte
+// swaps, or a plain copy when the host is already big-endian) straight
+// into or out of the caller's buffer.
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Byte-reversing copies of count elements; dst may equal src
+void byteSwapCopy16(void *dst, const void *src, std::size_t count);
+void byteSwapCopy32(void *dst, const void *src, std::size_t count);
+void byteSwapCopy64(void *dst, const void *src, std::size_t count);
+
+// Copies count big-endian elements of size bytes into host order
+void networkToHost(void *dst, const void *src, std::size_t count, std::size_t size);
+
+// Cursor over encoded bytes. Unlike sf::Packet it can take whole arrays at
+// once and skip ahead; like sf::Packet it turns false on the first short read.
+class ByteReader
+{
+public:
+    ByteReader(const void *data, std::size_t size);
+    // Starts where the packet's own reads left off
+    explicit ByteReader(const sf::Packet &packet);
+
+    explicit operator bool() const { return ok; }
+    std::size_t position() const { return offset; }
+    std::size_t remaining() const { return size - offset; }
+
+    ByteReader &operator>>(bool &value);
+    ByteReader &operator>>(uint8_t &value);
+    ByteReader &operator>>(int32_t &value);
+    ByteReader &operator>>(uint32_t &value);
+    ByteReader &operator>>(int64_t &value);
+    ByteReader &operator>>(float &value);
+
+    // Reads count integers of T directly into dest
+    template <typename T>
+    ByteReader &readArray(T *dest, std::size_t count)
+    {
+        static_assert(std::is_integral<T>::value, "readArray decodes integers");
+        const uint8_t *source = take(count * sizeof(T));
+        if (source)
+            networkToHost(dest, source, count, sizeof(T));
+        return *this;
+    }
+
+    ByteReader &skip(std::size_t bytes);
+
+private:
+    const uint8_t *take(std::size_t bytes); // nullptr (and ok = false) if short
+
+    const uint8_t *data;
+    std::size_t size;
+    std::size_t offset = 0;
+    bool ok = true;
+};
+
+// Appends count integers of T to the packet in wire order
+template <typename T>
+void writeArray(sf::Packet &packet, const T *source, std::size_t count);
+
+extern template void writeArray<int32_t>(sf::Packet &, const int32_t *, std::size_t);
+extern template void writeArray<uint32_t>(sf::Packet &, const uint32_t *, std::size_t);
+extern template void writeArray<int16_t>(sf::Packet &, const int16_t *, std::size_t);
+extern template void writeArray<uint16_t>(sf::Packet &, const uint16_t *, std::size_t);
+extern template void writeArray<int64_t>(sf::Packet &, const int64_t *, std::size_t);
+extern template void writeArray<uint64_t>(sf::Packet &, const uint64_t *, std::size_t);
+extern template void writeArray<uint8_t>(sf::Packet &, const uint8_t *, std::size_t);
@@ -0,0 +1,7 @@
+#pragma once
+// Player state latency while a multi-megabyte map is in flight, over a
+// loopback connection throttled to a modest link rate: every message in one
+// FIFO against prioritized channels with the map sliced (see ChannelMux).
+
+// Prints state latency and map transfer time for both; returns the process exit code
+int runChannelBenchmark();
@@ -0,0 +1,54 @@
+#pragma once
+// Sends messages over one TCP connection on prioritized logical channels.
+// Channels drain highest priority first. A message larger than a slice goes
+// out as ChannelData frames of at most one slice each, and the next slice is
+// only chosen once the previous one is fully written, so a state update waits
+// behind at most one slice of a multi-megabyte map instead of all of it.
+// Messages that fit in a slice are sent as ordinary frames.
+#include "protocol.hpp"
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+const std::size_t DEFAULT_SLICE_SIZE = 16 * 1024;
+
+class ChannelMux
+{
+public:
+    // sliceSize caps the bytes of one frame on the wire, framing included
+    explicit ChannelMux(std::size_t sliceSize = DEFAULT_SLICE_SIZE);
+
+    // Queues on channelFor(type) of the packet's first byte
+    void push(const sf::Packet &packet);
+    void push(MessageChannel channel, const sf::Packet &packet);
+
+    // Writes queued frames until the socket stops taking them or maxBytes
+    // have gone out. Returns false if the connection failed.
+    bool flush(sf::TcpSocket &socket, std::size_t maxBytes = std::numeric_limits<std::size_t>::max());
+
+    std::size_t queuedBytes(MessageChannel channel) const;
+    bool empty() const;
+    uint64_t totalSent() const { return bytesSent; } // Bytes handed to the socket, framing included
+
+private:
+    static const std::size_t SLICE_HEAD_SIZE = 4 + 1 + 1; // Frame size, ChannelData, channel
+
+    struct Queue
+    {
+        std::deque<std::vector<uint8_t>> frames; // u32 size, then the payload
+        std::size_t offset = 0;                  // Bytes of the front frame already sliced out
+        std::size_t bytes = 0;                   // Unsent bytes across frames
+    };
+
+    // Moves the next frame or slice of the highest priority queue to wire
+    bool nextUnit();
+
+    std::size_t sliceSize;
+    Queue queues[MESSAGE_CHANNEL_COUNT];
+    std::vector<uint8_t> wire; // Frame being written
+    std::size_t wireSent = 0;
+    uint64_t bytesSent = 0;
+};
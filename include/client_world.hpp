@@ -0,0 +1,78 @@
+#pragma once
+// Client-side view of the game: map, local player and remote players, plus
+// the packet handlers that keep it in sync with the server.
+#include "player_table.hpp"
+#include "protocol.hpp"
+#include "shared_tile_map.hpp"
+#include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
+#include <cstdint>
+#include <vector>
+
+const float CLIENT_TILE_SIZE = 40.f;
+
+struct ClientWorld
+{
+    explicit ClientWorld(const sf::Texture &texture);
+
+    const sf::Texture &playerTexture;
+
+    // Map data variables
+    SharedTileMap clientTileMap; // Read through a TileReadGuard, change through a TilePatch
+    TileGrid incomingTiles;      // Map being received; published to clientTileMap by endMap
+    int clientMapWidth = 0;
+    int clientMapHeight = 0;
+    std::vector<sf::RectangleShape> mapShapes;
+    bool mapLoaded = false;
+
+    // Local player
+    uint32_t myPlayerId = static_cast<uint32_t>(-1); // Use uint32_t, init to invalid ID
+    sf::Sprite playerSprite;
+    bool myIsOnGround = true; // Assume starting on ground
+    uint32_t myShardId = INITIAL_SHARD_ID; // Shard with authority over the local player
+
+    // Other players
+    PlayerTable otherPlayers;
+
+    bool logEvents = true; // Print welcomes, joins, leaves and map loads to stdout
+};
+
+// Applies one server packet whose type has already been read. Returns false
+// if the payload was malformed. shardId is the connection it arrived on;
+// player updates from a shard without authority over that player are ignored,
+// which merges overlapping shard streams into one player table. A ShardInfo
+// from the authority renames its connection to the id it reports, so live
+// play and replays agree on which shard is ours.
+bool applyPacket(ClientWorld &world, PacketType type, sf::Packet &packet, uint32_t shardId = INITIAL_SHARD_ID);
+
+// Removes the players a lost shard had authority over
+void dropShardPlayers(ClientWorld &world, uint32_t shardId);
+// Renames a shard once it reports its id (see INITIAL_SHARD_ID)
+void relabelShard(ClientWorld &world, uint32_t fromShardId, uint32_t toShardId);
+
+// Regenerates mapShapes from clientTileMap
+void rebuildMapShapes(ClientWorld &world);
+
+// Streamed MapData (see MessageStream): tiles arrive in row-major order and
+// each row gets its geometry as soon as it is complete, so the map fills in
+// while it downloads. Tiles collect in incomingTiles; clientTileMap keeps a
+// blank map of the new size until endMap publishes them as one version.
+void beginMap(ClientWorld &world, uint32_t width, uint32_t height);
+void applyMapTiles(ClientWorld &world, std::size_t firstTile, const int32_t *tiles, std::size_t count);
+void endMap(ClientWorld &world, bool complete);
+
+// Encodes the current map as a PackedMapData message
+void writeMapData(const ClientWorld &world, sf::Packet &packet);
+
+// Layout of snapshots written by older captures (see ReplayReader::snapshotFormat)
+struct SnapshotFormat
+{
+    bool shardIds = true;    // Authority shard of us and each player (replay version 2 on)
+    bool packedTiles = true; // TileGrid::write layout (version 4 on); before: u32 width, u32 height, raw i32 rows
+};
+
+// Full state of the map, local player and other players (replay keyframes).
+// Without shard ids everyone belongs to INITIAL_SHARD_ID. Fails on a
+// malformed snapshot, including one that lists a player id twice.
+void writeSnapshot(const ClientWorld &world, sf::Packet &packet);
+bool readSnapshot(ClientWorld &world, sf::Packet &packet, const SnapshotFormat &format = SnapshotFormat());
@@ -0,0 +1,6 @@
+#pragma once
+// Throughput of the bulk array codec against per-element sf::Packet
+// operators on large tile arrays.
+
+// Prints GB/s for each path; returns the process exit code (1 if the paths disagree)
+int runCodecBenchmark();
@@ -0,0 +1,69 @@
+#pragma once
+// Epoch-based reclamation for data that readers use without locks. A reader
+// pins the current epoch while it holds pointers into shared data; a writer
+// that unlinks an object retires it instead of deleting it, and the object is
+// destroyed once every reader pinned at the time has left. Readers only touch
+// their own slot, so they never contend with each other or block a writer.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class EpochDomain
+{
+public:
+    static const std::size_t MAX_READER_THREADS = 64;
+
+    // Pins the calling thread. Nestable; only the outermost pair counts.
+    // Threads claim a slot on first use and free it when they exit; past
+    // MAX_READER_THREADS threads, enter() waits for a slot.
+    void enter();
+    void leave();
+
+    // Destroys object with destroy(object) once no reader can still see it.
+    // Call after the object has been unlinked from the shared structure.
+    void retire(void *object, void (*destroy)(void *));
+    // Destroys whatever is safe to; writers call it after retiring. Returns
+    // the number of objects destroyed.
+    std::size_t collect();
+
+    std::size_t pendingCount();
+
+private:
+    friend struct EpochThreadSlot;
+
+    struct alignas(64) Slot // One cache line each so pins do not false-share
+    {
+        std::atomic<uint64_t> epoch{0}; // 0 when not pinned
+        std::atomic<bool> claimed{false};
+    };
+
+    struct Retired
+    {
+        uint64_t epoch;
+        void *object;
+        void (*destroy)(void *);
+    };
+
+    std::size_t claimSlot();
+    void releaseSlot(std::size_t slot);
+
+    std::atomic<uint64_t> globalEpoch{1};
+    Slot slots[MAX_READER_THREADS];
+    std::mutex retiredMutex;
+    std::vector<Retired> retired;
+};
+
+// Process-wide domain shared by every lock-free structure in the client.
+EpochDomain &epochDomain();
+
+// Pins epochDomain() for the lifetime of the guard
+class EpochGuard
+{
+public:
+    EpochGuard() { epochDomain().enter(); }
+    ~EpochGuard() { epochDomain().leave(); }
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+};
@@ -0,0 +1,75 @@
+#pragma once
+// Frame capture that keeps the render loop's timing intact: the render thread
+// only queues a read of the back buffer into a pixel buffer object and maps it
+// a frame or two later, once its fence has signalled, so it never waits on the
+// GPU. Background workers flip, encode and write the mapped pixels, and the
+// render thread unmaps the buffer when they are done. When no buffer is free
+// the frame is dropped instead of waiting. Contexts without pixel buffers or
+// fences fall back to a blocking glReadPixels.
+#include "metrics.hpp"
+#include <SFML/Graphics.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FrameCapture
+{
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Allocates bufferCount frames of the given size up front and starts the workers
+    bool start(const std::string &directory, sf::Vector2u frameSize, std::size_t bufferCount = 8,
+               unsigned workerCount = 2);
+    // Writes out the frames already captured, then joins the workers. Needs
+    // the capturing window's context active, like capture(), so call it
+    // before the window closes.
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Render thread: call after drawing and before window.display()
+    void capture(sf::RenderWindow &window);
+
+private:
+    struct Frame
+    {
+        std::vector<uint8_t> pixels;     // RGBA top-down once encoded; bottom-up from the blocking read
+        unsigned int buffer = 0;         // Pixel buffer object, 0 when reading back directly
+        void *fence = nullptr;           // GLsync signalled when the read into buffer has landed
+        const uint8_t *mapped = nullptr; // buffer's contents while a worker encodes them
+        sf::Vector2u size;
+        uint64_t number = 0;
+    };
+
+    void createBuffers();
+    // Maps pending reads whose fence has signalled and hands them to the
+    // workers, oldest first; wait blocks until every pending read is in
+    void collectReads(bool wait);
+    // Unmaps frames the workers are done with and makes them free again
+    void recycleEncoded();
+    void deleteBuffers();
+    void workerLoop();
+    void encode(Frame &frame);
+
+    std::string directory;
+    std::vector<Frame> frames;
+    std::vector<std::size_t> freeFrames;    // Render thread only
+    std::vector<std::size_t> pendingFrames; // Render thread only; reads in flight, oldest first
+    std::vector<std::size_t> readyFrames;   // Guarded by mutex
+    std::vector<std::size_t> encodedFrames; // Guarded by mutex
+    std::vector<std::size_t> recycling;     // Render thread only; encodedFrames taken out of the lock
+    bool buffersCreated = false;
+    std::mutex mutex;
+    std::condition_variable frameReady;
+    std::vector<std::thread> workers;
+    bool running = false;
+    bool stopping = false; // Guarded by mutex
+    uint64_t nextFrameNumber = 0;
+
+    MetricCounter &capturedFrames;
+    MetricCounter &droppedFrames;
+    MetricCounter &writtenFrames;
+};
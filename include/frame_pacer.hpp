@@ -0,0 +1,51 @@
+#pragma once
+// Frame pacing that starts each frame as late as it can. The time a frame
+// spends simulating and rendering is predicted from recent frames, and the
+// pacer sleeps until just before the next present deadline minus that, so
+// input sampled during the frame is fresh when it reaches the screen.
+#include <SFML/System.hpp>
+
+class FramePacer
+{
+public:
+    // lateStart false keeps the old behaviour (start at once, let the
+    // window's frame limiter sleep after rendering) while still measuring
+    FramePacer(sf::Time framePeriod, bool lateStart);
+
+    // Call at the top of the frame; sleeps when starting late
+    void waitForFrameStart();
+    void markInputSampled();
+    void markSimulationDone(); // Rendering starts
+    void markPresented();      // After display()
+
+    bool startsLate() const { return lateStart; }
+    sf::Time inputToPresent() const { return lastInputToPresent; }
+    sf::Time predictedSimulation() const { return simulation.predict(); }
+    sf::Time predictedRender() const { return render.predict(); }
+    bool missedDeadline() const { return lastMissed; } // Previous frame presented late
+
+private:
+    // Exponentially weighted mean and mean deviation of a phase duration;
+    // the prediction covers most frames rather than the average one
+    struct PhaseEstimate
+    {
+        void add(sf::Time sample);
+        sf::Time predict() const;
+
+        float meanSeconds = 0.f;
+        float deviationSeconds = 0.f;
+    };
+
+    sf::Time period;
+    bool lateStart;
+    sf::Clock clock;
+    sf::Time deadline;      // Present deadline of the current frame
+    sf::Time frameStart;
+    sf::Time simulationEnd;
+    sf::Time inputSampled;
+    bool inputSampledThisFrame = false;
+    sf::Time lastInputToPresent;
+    bool lastMissed = false;
+    PhaseEstimate simulation;
+    PhaseEstimate render;
+};
@@ -0,0 +1,18 @@
+#pragma once
+// Process memory sampling for metrics and diagnostics.
+#include <cstddef>
+
+// Resident set size of this process in bytes, or 0 where unsupported.
+std::size_t residentMemoryBytes();
+
+// Allocator view of the heap. Free bytes held by the allocator but not in use
+// are the fragmentation signal; available is false where the C library has no
+// statistics interface.
+struct HeapStats
+{
+    bool available = false;
+    std::size_t inUseBytes = 0; // Handed out to the program
+    std::size_t freeBytes = 0;  // Held by the allocator but unused
+};
+
+HeapStats heapStats();
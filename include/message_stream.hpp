@@ -0,0 +1,91 @@
+#pragma once
+// Splits a raw TCP byte stream into sf::Packet frames (u32 big-endian size,
+// then the payload). Ordinary messages are handed over whole; a large MapData
+// is decoded as its bytes arrive, so parsing overlaps the transfer and only a
+// few tiles are ever buffered. Whole messages are capped in size, so a
+// stream never buffers more than one capped message at a time. ChannelData slices are reassembled by one
+// nested stream per channel, so a sliced message arrives as if sent whole.
+#include "protocol.hpp"
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// MapData frames at least this large are streamed instead of buffered
+const std::size_t STREAMED_MESSAGE_THRESHOLD = 64 * 1024;
+// Largest frame buffered whole (everything but a streamed MapData, including
+// PackedMapData and messages reassembled from ChannelData slices). Larger
+// frames are skipped without being buffered. 16 MiB holds a 4096 x 4096
+// PackedMapData at 8 bits per tile.
+const std::size_t MAX_BUFFERED_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+class MessageSink
+{
+public:
+    virtual ~MessageSink() = default;
+
+    // A complete message; its type has already been read
+    virtual void onMessage(PacketType type, sf::Packet &packet) = 0;
+
+    // Streamed MapData: dimensions, then row-major tiles as they arrive, then
+    // the end (complete is false if the stream was cut off)
+    virtual void onMapBegin(uint32_t width, uint32_t height) = 0;
+    virtual void onMapTiles(std::size_t firstTile, const int32_t *tiles, std::size_t count) = 0;
+    virtual void onMapEnd(bool complete) = 0;
+};
+
+class MessageStream
+{
+public:
+    MessageStream() = default;
+
+    void feed(const uint8_t *data, std::size_t size, MessageSink &sink);
+    // The connection closed; ends a map that was still streaming
+    void abort(MessageSink &sink);
+
+private:
+    enum class Stage
+    {
+        Size,     // Reading the 4-byte frame size
+        Head,     // Reading the type byte and, for MapData, its dimensions
+        Body,     // Buffering an ordinary message
+        MapTiles, // Decoding tiles of a streamed MapData
+        Skip      // Discarding a frame over MAX_BUFFERED_MESSAGE_SIZE
+    };
+
+    static const std::size_t MAP_HEAD_SIZE = 1 + 4 + 4; // Type, width, height
+    static const std::size_t DECODE_BATCH = 1024;       // Tiles converted per onMapTiles call
+
+    explicit MessageStream(MessageChannel channel);
+
+    bool streamsAsMap() const; // Valid once the type byte is in head
+    void finishHead(MessageSink &sink);
+    void finishBody(MessageSink &sink);
+    std::size_t feedTiles(const uint8_t *data, std::size_t size, MessageSink &sink);
+    void feedChannel(uint8_t channelIndex, const uint8_t *data, std::size_t size, MessageSink &sink);
+    // Records per-channel delivery metrics for a message just handed to the sink
+    void delivered(MessageChannel deliveredOn);
+
+    bool nested = false;
+    MessageChannel channel = MessageChannel::Realtime; // Nested streams only
+    std::unique_ptr<MessageStream> channelStreams[MESSAGE_CHANNEL_COUNT];
+    sf::Time messageStart;                            // First byte of the current frame
+    sf::Time lastDelivery[MESSAGE_CHANNEL_COUNT] = {}; // Outer stream only; zero until a channel delivers
+    sf::Time *outerDeliveries = nullptr; // Nested only: the outer stream's lastDelivery, set before each feed
+
+    Stage stage = Stage::Size;
+    uint8_t sizeBytes[4];
+    std::size_t sizeFilled = 0;
+    uint32_t frameSize = 0;
+    uint32_t skipRemaining = 0; // Bytes of a skipped frame still to come
+    uint8_t head[MAP_HEAD_SIZE];
+    std::size_t headFilled = 0;
+    std::vector<uint8_t> body; // Ordinary messages only; keeps its capacity
+
+    uint64_t tileCount = 0;
+    uint64_t tilesDelivered = 0;
+    uint8_t partialTile[4];
+    std::size_t partialFilled = 0;
+    int32_t decoded[DECODE_BATCH];
+};
@@ -0,0 +1,128 @@
+#pragma once
+// Lock-free client metrics and a localhost endpoint that serves them in the
+// Prometheus text exposition format.
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Monotonic counter. add() is a single relaxed atomic increment.
+class MetricCounter
+{
+public:
+    void add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+// Point-in-time value that can go up and down.
+class MetricGauge
+{
+public:
+    void set(double newValue) { value.store(newValue, std::memory_order_relaxed); }
+    void add(double amount);
+    double get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value{0.0};
+};
+
+// Fixed-bucket histogram. observe() never allocates or locks.
+class MetricHistogram
+{
+public:
+    explicit MetricHistogram(std::vector<double> bucketUpperBounds);
+
+    void observe(double sample);
+
+    const std::vector<double> &bounds() const { return upperBounds; }
+    uint64_t bucketCount(std::size_t index) const { return buckets[index].load(std::memory_order_relaxed); } // Non-cumulative
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    double sum() const { return sampleSum.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> upperBounds;                    // Sorted, +Inf bucket is implicit
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;   // upperBounds.size() + 1 entries
+    std::atomic<uint64_t> total{0};
+    std::atomic<double> sampleSum{0.0};
+};
+
+// Owns every metric. Registration and rendering take a mutex; updating a
+// registered metric never does, so hot paths only touch atomics.
+class MetricsRegistry
+{
+public:
+    // labels are preformatted, e.g. "type=\"PlayerState\"" (empty for none)
+    // Reusing a name with a different metric type throws std::logic_error
+    MetricCounter &counter(const std::string &name, const std::string &help, const std::string &labels = "");
+    MetricGauge &gauge(const std::string &name, const std::string &help, const std::string &labels = "");
+    MetricHistogram &histogram(const std::string &name, const std::string &help, std::vector<double> bucketUpperBounds,
+                               const std::string &labels = "");
+
+    // Collectors run on the scraping thread right before rendering, e.g. to
+    // sample process memory without costing the render thread anything.
+    void addCollector(std::function<void()> collector);
+
+    std::string renderText();
+
+private:
+    enum class Kind
+    {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct Series
+    {
+        std::string labels;
+        void *metric;
+    };
+
+    struct Family
+    {
+        std::string name;
+        std::string help;
+        Kind kind;
+        std::vector<Series> series;
+    };
+
+    Family &family(const std::string &name, const std::string &help, Kind kind);
+
+    std::mutex mutex;
+    std::deque<Family> families;
+    std::deque<MetricCounter> counters;     // deques keep references stable
+    std::deque<MetricGauge> gauges;
+    std::deque<std::unique_ptr<MetricHistogram>> histograms;
+    std::vector<std::function<void()>> collectors;
+};
+
+// Process-wide registry used by the client and its subsystems.
+MetricsRegistry &metricsRegistry();
+
+// Serves metricsRegistry() over plain HTTP on a loopback port from its own
+// thread. Any request gets the full snapshot back.
+class MetricsServer
+{
+public:
+    ~MetricsServer();
+
+    bool start(unsigned short port);
+    void stop();
+
+private:
+    void run();
+    void serve(sf::TcpSocket &client);
+
+    sf::TcpListener listener;
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
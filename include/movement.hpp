@@ -0,0 +1,45 @@
+#pragma once
+// Player movement: the constants the server simulates with and a client-side
+// step that follows the same rules. Navigation derives its links from it.
+#include "protocol.hpp"
+#include "shared_tile_map.hpp"
+#include "tile_grid.hpp"
+#include <SFML/System.hpp>
+
+// Mirrors the server's movement constants; keep in sync with it
+struct MovementParams
+{
+    float tileSize = 40.f;     // Pixels per tile (CLIENT_TILE_SIZE)
+    float runSpeed = 200.f;    // Horizontal speed, px/s
+    float jumpSpeed = 450.f;   // Initial upward speed of a jump, px/s
+    float gravity = 980.f;     // px/s^2
+    float maxFallSpeed = 800.f;
+    float bodyWidth = 28.f;    // Collision box centred on the position, px
+    float bodyHeight = 60.f;
+    float tickSeconds = 1.f / 60.f; // Server simulation step
+};
+
+struct MovementState
+{
+    sf::Vector2f position; // Centre of the collision box (the sprite origin)
+    sf::Vector2f velocity;
+    bool onGround = false;
+};
+
+// Advances one step over a tile map (1 = solid); everything outside the map is solid.
+// Tiles is a TileGrid or a TileMapVersion; read ClientWorld::clientTileMap
+// through a TileReadGuard held for the whole step.
+template <typename Tiles>
+void stepMovement(MovementState &state, const PlayerInputState &input, const MovementParams &params,
+                  const Tiles &tiles);
+
+// True if the tile is solid or outside the map
+template <typename Tiles>
+bool isSolidTile(const Tiles &tiles, int x, int y);
+
+extern template void stepMovement<TileGrid>(MovementState &, const PlayerInputState &, const MovementParams &,
+                                            const TileGrid &);
+extern template void stepMovement<TileMapVersion>(MovementState &, const PlayerInputState &,
+                                                  const MovementParams &, const TileMapVersion &);
+extern template bool isSolidTile<TileGrid>(const TileGrid &, int, int);
+extern template bool isSolidTile<TileMapVersion>(const TileMapVersion &, int, int);
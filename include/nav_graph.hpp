@@ -0,0 +1,121 @@
+#pragma once
+// Navigation graph over the tile grid for bot clients. Nodes are tiles a
+// player can stand in; links are walks to a neighbouring tile plus the falls
+// and jumps found by running stepMovement from every node, so a bot that
+// replays a link's input lands where the graph says. Graphs are built in
+// parallel, cached on disk per map hash and searched with A*.
+#include "movement.hpp"
+#include <SFML/System.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class NavEdgeKind : uint8_t
+{
+    Walk, // To the neighbouring tile on the same floor
+    Fall, // Walk off a ledge
+    Jump
+};
+
+struct NavEdge
+{
+    uint32_t target;
+    NavEdgeKind kind;
+    int8_t direction;   // -1 left, +1 right
+    uint16_t holdTicks; // Fall/Jump: ticks the direction is held after take-off
+    float cost;         // Seconds to traverse
+};
+
+struct NavNode
+{
+    int32_t x; // Tile the lower half of the body occupies
+    int32_t y;
+};
+
+class NavGraph
+{
+public:
+    // Tiles is a TileGrid or a TileMapVersion (see stepMovement). Worker
+    // threads read it while build runs, so a version stays pinned until then.
+    template <typename Tiles>
+    void build(const Tiles &tiles, const MovementParams &params);
+    // Loads the cached graph for this map, building and caching it on a miss
+    template <typename Tiles>
+    void loadOrBuild(const Tiles &tiles, const MovementParams &params, const std::string &cacheDirectory);
+
+    std::size_t nodeCount() const { return nodes.size(); }
+    std::size_t edgeCount() const { return edges.size(); }
+    const NavNode &node(uint32_t index) const { return nodes[index]; }
+    const NavEdge *edgesBegin(uint32_t index) const { return edges.data() + edgeOffsets[index]; }
+    const NavEdge *edgesEnd(uint32_t index) const { return edges.data() + edgeOffsets[index + 1]; }
+    const MovementParams &movement() const { return params; }
+    // Nodes share a component when each can reach the other; a path between
+    // two nodes of the same component always exists
+    uint32_t component(uint32_t index) const { return components[index]; }
+    // The link from one node to another, or nullptr
+    const NavEdge *findEdge(uint32_t from, uint32_t to) const;
+
+    // Node under a player at this position, or -1 if it is not standing on one
+    int32_t nodeAt(sf::Vector2f position) const;
+    // Position of a player standing in the middle of the node
+    sf::Vector2f nodePosition(uint32_t index) const;
+
+    // Same value for a TileGrid and a TileMapVersion with the same tiles
+    template <typename Tiles>
+    static uint64_t mapHash(const Tiles &tiles, const MovementParams &params);
+
+private:
+    int32_t nodeIndexAt(int x, int y) const;
+    void labelComponents();
+    bool load(const std::string &path, uint64_t hash);
+    bool save(const std::string &path, uint64_t hash) const;
+
+    MovementParams params;
+    int width = 0;
+    int height = 0;
+    std::vector<NavNode> nodes;
+    std::vector<int32_t> nodeIndex;    // Per tile, -1 where nobody can stand
+    std::vector<uint32_t> edgeOffsets; // Edges of node i are [edgeOffsets[i], edgeOffsets[i + 1])
+    std::vector<NavEdge> edges;
+    std::vector<uint32_t> components; // Strongly connected component per node
+};
+
+extern template void NavGraph::build<TileGrid>(const TileGrid &, const MovementParams &);
+extern template void NavGraph::build<TileMapVersion>(const TileMapVersion &, const MovementParams &);
+extern template void NavGraph::loadOrBuild<TileGrid>(const TileGrid &, const MovementParams &, const std::string &);
+extern template void NavGraph::loadOrBuild<TileMapVersion>(const TileMapVersion &, const MovementParams &,
+                                                           const std::string &);
+extern template uint64_t NavGraph::mapHash<TileGrid>(const TileGrid &, const MovementParams &);
+extern template uint64_t NavGraph::mapHash<TileMapVersion>(const TileMapVersion &, const MovementParams &);
+
+// Reusable A* state, one per thread. The scratch arrays are stamped per
+// search instead of cleared, so a query only costs the nodes it touches.
+class NavQuery
+{
+public:
+    explicit NavQuery(const NavGraph &graph);
+
+    // Fills path with the nodes from start to goal inclusive; false if unreachable
+    bool findPath(uint32_t start, uint32_t goal, std::vector<uint32_t> &path);
+
+    std::size_t lastExpanded() const { return expanded; }
+
+private:
+    struct OpenEntry
+    {
+        float priority;
+        uint32_t node;
+        bool operator>(const OpenEntry &other) const { return priority > other.priority; }
+    };
+
+    float heuristic(uint32_t from, uint32_t goal) const;
+
+    const NavGraph &graph;
+    std::vector<float> costSoFar;
+    std::vector<uint32_t> cameFrom;
+    std::vector<uint32_t> visitedStamp;
+    std::vector<uint32_t> closedStamp;
+    std::vector<OpenEntry> open;
+    uint32_t stamp = 0;
+    std::size_t expanded = 0;
+};
@@ -0,0 +1,19 @@
+#pragma once
+// Checks the client movement simulation against the server. A capture's
+// recorded inputs are replayed through stepMovement and every step is
+// compared with the local player's authoritative PlayerState; divergence
+// statistics and simulation throughput are reported.
+#include <cstdint>
+#include <string>
+
+struct ParityOptions
+{
+    std::string capturePath;
+    float tolerancePixels = 1.f;        // Larger errors count as divergent and resync the simulation
+    double maxDivergentFraction = 0.01; // Share of divergent ticks that still passes
+    int maxInputDelayTicks = 30;        // Input-to-state delays tried when aligning the streams
+};
+
+// Returns the process exit code: 0 on pass, 1 if the simulation diverged or
+// the capture could not be used.
+int runPhysicsParity(const ParityOptions &options);
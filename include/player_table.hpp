@@ -0,0 +1,54 @@
+#pragma once
+// Remote players, stored densely so join/leave churn reuses memory instead of
+// allocating a sprite and five map nodes per player.
+#include "animation.hpp"
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct RemotePlayer
+{
+    RemotePlayer(uint32_t playerId, const sf::Texture &texture);
+
+    uint32_t id;
+    sf::Sprite sprite;
+    PlayerAnimState animState = PlayerAnimState::Stand;
+    int currentFrame = 0;
+    sf::Time animTimer = sf::Time::Zero;
+    bool facingRight = true; // Default direction
+    bool onGround = true;
+    uint32_t authorityShard = 0; // Only this shard's updates move the player
+};
+
+class PlayerTable
+{
+public:
+    explicit PlayerTable(const sf::Texture &texture);
+
+    RemotePlayer *find(uint32_t id);
+    const RemotePlayer *find(uint32_t id) const;
+
+    // Adds a player in its default state. The id must not be present yet.
+    RemotePlayer &insert(uint32_t id);
+    // Returns false if the id was unknown
+    bool erase(uint32_t id);
+    void clear();
+
+    // Advances every remote player's animation by dt
+    void animate(sf::Time dt);
+
+    std::size_t size() const { return players.size(); }
+    std::vector<RemotePlayer>::iterator begin() { return players.begin(); }
+    std::vector<RemotePlayer>::iterator end() { return players.end(); }
+    std::vector<RemotePlayer>::const_iterator begin() const { return players.begin(); }
+    std::vector<RemotePlayer>::const_iterator end() const { return players.end(); }
+
+private:
+    using Index = std::unordered_map<uint32_t, std::size_t>;
+
+    const sf::Texture &texture;
+    std::vector<RemotePlayer> players; // Dense; erase swaps with the last entry
+    Index index;                       // id -> position in players
+    std::vector<Index::node_type> spareNodes; // Recycled index nodes, so steady churn never allocates
+};
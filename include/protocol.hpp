@@ -0,0 +1,60 @@
+#pragma once
+// Wire protocol shared with the server: packet types and their encodings.
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// Player input state structure (Removed up/down as they are not used for rope)
+struct PlayerInputState
+{
+    bool up = false;   // Removed
+    bool down = false; // Removed
+    bool left = false;
+    bool right = false;
+    bool jump = false; // Using Space for jump
+};
+
+// Packet type enumeration
+enum class PacketType : uint8_t
+{ // Explicit underlying type
+    Welcome,
+    PlayerState,
+    PlayerInput,
+    PlayerJoined,
+    PlayerLeft,
+    MapData,
+    ShardInfo,    // u32 sender shard id, u32 count, count * (u32 shard id, string dotted IPv4 host, u16 port) of neighbours
+    ShardHandoff, // u32 player id, u32 shard id now authoritative for that player
+    ShardAttach,  // Client -> neighbour shard: u32 player id, mirror entities near our border
+    PackedMapData, // MapData with palettized, bit-packed tiles (see TileGrid::write)
+    ChannelData    // u8 channel, then a slice of that channel's frame stream (see ChannelMux)
+};
+
+const uint8_t PACKET_TYPE_COUNT = static_cast<uint8_t>(PacketType::ChannelData) + 1;
+
+// Logical channels multiplexed over one connection, highest priority first.
+// Order is kept within a channel, not across channels.
+enum class MessageChannel : uint8_t
+{
+    Control,  // Welcome, shard management
+    Realtime, // Player states, joins, leaves, handoffs and input
+    Bulk      // Maps
+};
+
+const uint8_t MESSAGE_CHANNEL_COUNT = static_cast<uint8_t>(MessageChannel::Bulk) + 1;
+
+// Label of the first server connected to until it reports its real shard id
+const uint32_t INITIAL_SHARD_ID = 0;
+
+// sf::Packet frames every message with a 32-bit size
+const std::size_t PACKET_SIZE_PREFIX = sizeof(uint32_t);
+
+sf::Packet &operator<<(sf::Packet &packet, const PlayerInputState &input);
+sf::Packet &operator>>(sf::Packet &packet, PlayerInputState &input);
+sf::Packet &operator<<(sf::Packet &packet, PacketType type);
+sf::Packet &operator>>(sf::Packet &packet, PacketType &type);
+
+const char *packetTypeName(PacketType type);
+MessageChannel channelFor(PacketType type);
+bool isMapMessage(PacketType type); // MapData or PackedMapData
+const char *channelName(MessageChannel channel);
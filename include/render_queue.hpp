@@ -0,0 +1,57 @@
+#pragma once
+// Collects a frame's draw items, sorts them by a packed key and draws them
+// as few batched triangle lists as possible. Systems submit in any order;
+// the key decides what ends up on top.
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// Back to front. Items in a higher layer always cover lower ones.
+enum class RenderLayer : uint8_t
+{
+    Map,
+    Players,
+    LocalPlayer,
+    Overlay
+};
+
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        std::size_t items = 0;
+        std::size_t drawCalls = 0; // Batches only break on a texture change, so this also counts state switches
+    };
+
+    // Within a layer, items are grouped by texture and then drawn by
+    // ascending depth; equal keys keep their submission order. Depth only
+    // orders items that share a layer and texture.
+    void submit(RenderLayer layer, const sf::Sprite &sprite, float depth = 0.f);
+    void submit(RenderLayer layer, const sf::RectangleShape &shape, float depth = 0.f);
+
+    // Sorts, draws and clears the queue
+    void flush(sf::RenderTarget &target);
+
+    const Stats &lastStats() const { return stats; }
+
+private:
+    struct Item
+    {
+        const sf::Texture *texture; // nullptr for plain colour
+        sf::Vertex corners[4];      // Top-left, top-right, bottom-right, bottom-left
+    };
+
+    uint16_t textureId(const sf::Texture *texture);
+    void push(RenderLayer layer, float depth, const Item &item);
+    void sortKeys();
+
+    std::vector<Item> items;
+    std::vector<uint64_t> keys;    // Parallel to items until sorted
+    std::vector<uint32_t> order;   // Item indices in sorted key order
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> orderScratch;
+    std::vector<const sf::Texture *> textures; // Index + 1 is the id in the key; 0 means untextured
+    std::vector<sf::Vertex> batch;
+    Stats stats;
+};
@@ -0,0 +1,128 @@
+#pragma once
+// Capture files of the server message stream with periodic full-state
+// keyframes, so playback can start from any timestamp without replaying
+// everything before it.
+//
+// Layout (all integers little-endian):
+//   header   "2DPR" u32 version
+//   records  u8 kind, u64 timeMicros, u32 size, size bytes
+//            Message: u32 shard id (version 2), then the raw sf::Packet payload as received
+//            Keyframe: ClientWorld snapshot (see writeSnapshot; raw tile rows
+//            before version 4)
+//            Input: u32 shard id, then the PlayerInput packet as sent (version 3)
+//   index    u32 count, count * (u64 timeMicros, u64 recordOffset)
+//   footer   u64 indexOffset "2DPI"
+// A capture cut short before the index is written is indexed by scanning.
+#include "client_world.hpp"
+#include <SFML/Network.hpp>
+#include <SFML/System.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Stored in the file; never renumber
+enum class ReplayRecordKind : uint8_t
+{
+    Message,
+    Keyframe,
+    Input
+};
+
+struct ReplayRecord
+{
+    ReplayRecordKind kind;
+    sf::Time time;
+    uint32_t shardId = 0; // Messages and inputs
+    sf::Packet packet;
+};
+
+class ReplayWriter
+{
+public:
+    ~ReplayWriter();
+
+    bool open(const std::string &path, sf::Time keyframeInterval);
+    bool isOpen() const { return file.is_open(); }
+
+    // Call with the world once per frame; writes a keyframe when one is due
+    void writeKeyframeIfDue(sf::Time time, const ClientWorld &world);
+    void writeMessage(sf::Time time, uint32_t shardId, const sf::Packet &packet);
+    // Input the client sent, so the client simulation can be checked against the server
+    void writeInput(sf::Time time, uint32_t shardId, const sf::Packet &packet);
+    void close();
+
+private:
+    struct IndexEntry
+    {
+        uint64_t timeMicros;
+        uint64_t offset;
+    };
+
+    void writeRecordHeader(ReplayRecordKind kind, sf::Time time, std::size_t size);
+    void writeShardPacket(ReplayRecordKind kind, sf::Time time, uint32_t shardId, const sf::Packet &packet);
+
+    std::ofstream file;
+    sf::Time keyframeInterval;
+    sf::Time nextKeyframe = sf::Time::Zero;
+    std::vector<IndexEntry> keyframes;
+    sf::Packet scratch; // Reused for snapshots
+};
+
+class ReplayReader
+{
+public:
+    bool open(const std::string &path);
+
+    sf::Time duration() const { return endTime; }
+    sf::Time position() const { return playhead; }
+    bool finished() const { return atEnd; }
+    // Layout of this capture's keyframes; pass to readSnapshot
+    const SnapshotFormat &snapshotFormat() const { return format; }
+
+    // Restores the nearest keyframe at or before time, then applies the
+    // messages between it and time without pacing.
+    bool seek(sf::Time time, ClientWorld &world);
+    // Applies every message up to time. Returns the number applied.
+    std::size_t advance(sf::Time time, ClientWorld &world);
+
+    // Sequential access for analysis tools: rewind, then read every record
+    // in file order. Returns false at the end.
+    void rewind();
+    bool readRecord(ReplayRecord &record);
+
+private:
+    enum class Peek
+    {
+        Record,
+        End,
+        Error
+    };
+
+    struct IndexEntry
+    {
+        uint64_t timeMicros;
+        uint64_t offset;
+    };
+
+    bool loadIndex();
+    bool scanIndex();
+    Peek peekRecord();
+    bool readPayload(sf::Packet &packet);
+    // Consumes the shard id of a message or input record (INITIAL_SHARD_ID before version 2)
+    bool readShardId(uint32_t &shardId);
+
+    std::ifstream file;
+    std::vector<IndexEntry> keyframes;
+    uint64_t recordsEnd = 0; // Offset where records stop (index start or EOF)
+    sf::Time endTime = sf::Time::Zero;
+    sf::Time playhead = sf::Time::Zero;
+    bool atEnd = false;
+    SnapshotFormat format; // Also says whether records carry shard ids
+
+    // Header of the record at the read position, valid after peekRecord()
+    uint8_t pendingKind = 0;
+    sf::Time pendingTime;
+    uint32_t pendingSize = 0;
+    std::vector<char> payload;
+};
@@ -0,0 +1,103 @@
+#pragma once
+// Connections to the shard that owns the local player and to the neighbouring
+// shards it advertises. Neighbours are connected ahead of time, so a handoff
+// only changes where input goes; their entity streams are merged into the one
+// player table by authority (see applyPacket).
+#include "client_world.hpp"
+#include "message_stream.hpp"
+#include "metrics.hpp"
+#include "protocol.hpp"
+#include <SFML/Network.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class ShardSet
+{
+public:
+    // MessageSink callbacks tagged with the shard they came from
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+        virtual void onMessage(uint32_t shardId, PacketType type, sf::Packet &packet) = 0;
+        virtual void onMapBegin(uint32_t shardId, uint32_t width, uint32_t height) = 0;
+        virtual void onMapTiles(uint32_t shardId, std::size_t firstTile, const int32_t *tiles, std::size_t count) = 0;
+        virtual void onMapEnd(uint32_t shardId, bool complete) = 0;
+    };
+
+    explicit ShardSet(ClientWorld &world);
+
+    // Starts connecting to the first server; it reports its shard id via ShardInfo
+    void connectInitial(sf::IpAddress address, unsigned short port);
+
+    // Advances pending connects and drains every connected shard
+    void poll(Handler &handler);
+
+    // Sends to the shard with authority over the local player. Until that
+    // shard is connected, the previous authority keeps receiving input.
+    // Returns false if there is no shard to send to or the packet was
+    // dropped; what the socket cannot take yet is sent on later polls.
+    bool sendToAuthority(sf::Packet &packet);
+
+    // True while input has somewhere to go
+    bool isConnected() const { return authorityConnection() != nullptr || lastAuthority != nullptr; }
+    // True once connected and then left with no shard to send input to
+    bool lostAuthority() const { return hadConnection && !isConnected(); }
+
+private:
+    enum class State
+    {
+        Connecting,
+        Connected
+    };
+
+    struct Shard : MessageSink
+    {
+        Shard(ShardSet &owner, uint32_t id, sf::IpAddress address, unsigned short port);
+
+        void onMessage(PacketType type, sf::Packet &packet) override;
+        void onMapBegin(uint32_t width, uint32_t height) override;
+        void onMapTiles(std::size_t firstTile, const int32_t *tiles, std::size_t count) override;
+        void onMapEnd(bool complete) override;
+
+        ShardSet &owner;
+
+        uint32_t id;
+        sf::IpAddress address;
+        unsigned short port;
+        sf::TcpSocket socket;
+        State state = State::Connecting;
+        sf::Clock connectTimer;
+        bool wanted = true; // Listed by the authority shard's last ShardInfo
+        MessageStream stream;
+        std::deque<sf::Packet> outgoing; // Not yet fully sent; the front may be partly on the wire
+
+        MetricCounter *bytesReceived = nullptr;
+        MetricCounter *packetsReceived = nullptr;
+        MetricCounter *bytesSent = nullptr;
+        MetricCounter *packetsSent = nullptr;
+    };
+
+    Shard &addShard(uint32_t id, sf::IpAddress address, unsigned short port);
+    void registerMetrics(Shard &shard);
+    void startConnect(Shard &shard);
+    void onConnected(Shard &shard);
+    bool receiveAll(Shard &shard); // false once disconnected
+    // Queues behind anything still unsent so frames never interleave
+    bool queueSend(Shard &shard, const sf::Packet &packet);
+    bool flushOutgoing(Shard &shard); // false once the connection failed
+    // fromAuthority: sent by our authority as known before the message relabelled it
+    void applyShardInfo(Shard &sender, bool fromAuthority, sf::Packet &packet);
+    void removeUnwanted(); // Closes neighbours the authority no longer lists
+    Shard *authorityConnection() const;
+
+    ClientWorld &world;
+    std::vector<std::unique_ptr<Shard>> shards;
+    Shard *lastAuthority = nullptr; // Fallback for input while a handoff target connects
+    bool hadConnection = false;
+    Handler *handler = nullptr; // Set for the duration of poll()
+    uint8_t receiveBuffer[16 * 1024];
+    MetricGauge &connectedShards;
+};
@@ -0,0 +1,132 @@
+#pragma once
+// Tile map that readers use without locks while a writer patches it. The map
+// is split into TILE_CHUNK_SIZE x TILE_CHUNK_SIZE chunks, each an immutable
+// TileGrid that versions share. A patch copies only the chunks it touches,
+// builds a new version around them and publishes it with one pointer swap.
+// The old version goes to epochDomain() together with the chunks that just
+// lost their last reference, and both are freed once no reader can still
+// hold them.
+//
+// Readers take a TileReadGuard and see one consistent version for as long as
+// they keep it. Writers (patches, reset, assign) are serialized per map.
+#include "epoch.hpp"
+#include "tile_grid.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+const int TILE_CHUNK_SIZE = 32; // Tiles per chunk side; a power of two
+
+struct TileChunk
+{
+    TileGrid tiles;
+    // Slots of the newest version that point here (blank chunks are shared
+    // across a map). Writer only: older versions are kept alive by the epoch
+    // their replacement was retired in, not by counts.
+    uint32_t references = 1;
+};
+
+// One immutable state of the map
+class TileMapVersion
+{
+public:
+    int width() const { return mapWidth; }
+    int height() const { return mapHeight; }
+
+    // Tile value at an in-range position
+    int at(int x, int y) const
+    {
+        const TileChunk *chunk = chunks[static_cast<std::size_t>(y / TILE_CHUNK_SIZE) * chunksX + x / TILE_CHUNK_SIZE];
+        return chunk->tiles.at(x % TILE_CHUNK_SIZE, y % TILE_CHUNK_SIZE);
+    }
+    void unpackRow(int y, int32_t *out) const; // width() values
+    void copyTo(TileGrid &grid) const;
+
+    uint64_t number() const { return versionNumber; } // Counts publishes since the map was created
+    std::size_t chunkCount() const { return chunks.size(); }
+    std::size_t memoryBytes() const;
+
+private:
+    friend class SharedTileMap;
+    friend class TilePatch;
+
+    int mapWidth = 0;
+    int mapHeight = 0;
+    int chunksX = 0;
+    uint64_t versionNumber = 0;
+    std::vector<TileChunk *> chunks; // Row-major
+};
+
+class SharedTileMap
+{
+public:
+    SharedTileMap();
+    ~SharedTileMap();
+    SharedTileMap(const SharedTileMap &) = delete;
+    SharedTileMap &operator=(const SharedTileMap &) = delete;
+
+    // Publishes an all-zero map; chunks of equal size share one copy
+    void reset(int width, int height);
+    // Publishes a copy of grid
+    void assign(const TileGrid &grid);
+
+    struct Stats
+    {
+        uint64_t versionsPublished = 0;
+        uint64_t chunksCopied = 0; // Copy-on-write copies made by patches
+    };
+    Stats stats() const;
+
+private:
+    friend class TilePatch;
+    friend class TileReadGuard;
+
+    // Caller holds writerMutex. dead: chunks no slot of next refers to.
+    void publish(TileMapVersion *next, std::vector<TileChunk *> dead);
+    // Drops every reference the current version holds, collecting the dead chunks
+    void releaseCurrent(std::vector<TileChunk *> &dead);
+
+    std::atomic<const TileMapVersion *> current{nullptr};
+    mutable std::mutex writerMutex;
+    uint64_t versionsPublished = 0;
+    uint64_t chunksCopied = 0;
+};
+
+// Pins the map's current version for reading
+class TileReadGuard
+{
+public:
+    explicit TileReadGuard(const SharedTileMap &map) : version(map.current.load(std::memory_order_seq_cst)) {}
+    const TileMapVersion &tiles() const { return *version; }
+
+private:
+    EpochGuard epoch; // Declared first so the pin precedes the load
+    const TileMapVersion *version;
+};
+
+// A batch of changes published as one version on commit(), or when the
+// patch is destroyed. Each chunk is copied at most once per patch. Holds the
+// map's writer lock until then; changes after commit() are ignored.
+class TilePatch
+{
+public:
+    explicit TilePatch(SharedTileMap &map);
+    ~TilePatch();
+    TilePatch(const TilePatch &) = delete;
+    TilePatch &operator=(const TilePatch &) = delete;
+
+    // In-range positions only
+    void set(int x, int y, int value);
+    void setRow(int y, int firstX, const int32_t *values, std::size_t count);
+    void commit();
+
+private:
+    TileGrid &writableChunk(int chunkX, int chunkY);
+
+    SharedTileMap &map;
+    std::unique_lock<std::mutex> lock;
+    TileMapVersion *next = nullptr;
+    std::vector<bool> copied; // Chunks already private to this patch
+    std::vector<TileChunk *> dead;
+};
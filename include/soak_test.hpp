@@ -0,0 +1,21 @@
+#pragma once
+// Headless join/leave churn soak test. A stand-in server streams join, state
+// and leave packets through the real packet handlers while RSS, allocator
+// statistics and frame time are sampled; memory that keeps growing after
+// warm-up fails the run.
+#include <cstddef>
+#include <cstdint>
+
+struct SoakOptions
+{
+    uint64_t cycles = 1000000;       // Join, state updates, leave
+    uint32_t population = 64;        // Remote players alive at any time
+    uint32_t statesPerCycle = 4;     // PlayerState packets per cycle
+    uint32_t cyclesPerFrame = 32;    // Work applied between two simulated frames
+    uint32_t samples = 200;          // Memory samples over the run
+    double warmupFraction = 0.1;     // Leading share of samples ignored for growth
+    std::size_t growthToleranceBytes = 1024 * 1024;
+};
+
+// Returns the process exit code: 0 on pass, 1 if memory grew after warm-up.
+int runSoakTest(const SoakOptions &options);
@@ -0,0 +1,8 @@
+#pragma once
+// Patch throughput of SharedTileMap while reader threads query it, next to
+// the same workload on a TileGrid behind one mutex. Readers also check that
+// every snapshot they see is consistent.
+
+// Prints patches/s and reads/s for each setup; returns the process exit code
+// (1 if a reader saw a torn snapshot)
+int runTileBenchmark();
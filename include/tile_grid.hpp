@@ -0,0 +1,63 @@
+#pragma once
+// Tile storage for one map: a palette of the distinct tile values and a
+// bit-packed palette index per tile. Indices take 1, 2, 4 or 8 bits
+// depending on how many distinct values the map uses (16 or 32 beyond
+// that), widening as new values appear. The same layout goes on the wire
+// as PackedMapData.
+#include "byte_codec.hpp"
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class TileGrid
+{
+public:
+    // Resizes to width x height tiles, all 0
+    void reset(int width, int height);
+
+    int width() const { return gridWidth; }
+    int height() const { return gridHeight; }
+
+    // Tile value at an in-range position
+    int at(int x, int y) const
+    {
+        const std::size_t bit = static_cast<std::size_t>(x) * bits;
+        const uint64_t word = words[static_cast<std::size_t>(y) * rowWords + (bit >> 6)];
+        return palette[static_cast<std::size_t>((word >> (bit & 63)) & mask)];
+    }
+    void set(int x, int y, int value);
+
+    // Bulk access along one row: count values starting at column firstX
+    void setRow(int y, int firstX, const int32_t *values, std::size_t count);
+    void unpackRow(int y, int32_t *out) const; // width() values
+
+    int bitsPerTile() const { return bits; }
+    std::size_t paletteSize() const { return palette.size(); }
+    std::size_t memoryBytes() const { return words.size() * sizeof(uint64_t) + palette.size() * sizeof(int32_t); }
+
+    // u32 width, u32 height, u8 bits per tile, u32 palette size, palette
+    // (i32 each), then each row's indices packed LSB first into whole bytes
+    void write(sf::Packet &packet) const;
+    bool read(ByteReader &reader);
+
+private:
+    static const std::size_t LINEAR_PALETTE_LIMIT = 16;
+
+    uint64_t paletteIndex(int value); // Adds new values, widening the indices when they run out
+    void widen();
+
+    int gridWidth = 0;
+    int gridHeight = 0;
+    int bits = 1;
+    uint64_t mask = 1;
+    std::size_t rowWords = 0; // Rows start on a word so they can be unpacked independently
+    std::vector<uint64_t> words;
+    std::vector<int32_t> palette{0};
+    // Only built past LINEAR_PALETTE_LIMIT values; small palettes are scanned,
+    // which also keeps copies (see SharedTileMap) free of hash tables
+    std::unordered_map<int32_t, uint64_t> paletteLookup;
+    int lastValue = 0; // Runs of equal tiles skip the lookup
+    uint64_t lastIndex = 0;
+};
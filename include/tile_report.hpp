@@ -0,0 +1,10 @@
+#pragma once
+// Measures what palettized tile storage saves on real maps. Every map a
+// capture delivers (MapData or PackedMapData) is decoded into a TileGrid and
+// its memory and wire sizes are compared with one int32 per tile.
+#include <string>
+#include <vector>
+
+// Prints a line per map and totals over all captures. Returns the process
+// exit code: 0 if at least one map was found.
+int runTileReport(const std::vector<std::string> &capturePaths);
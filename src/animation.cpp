@@ -0,0 +1,21 @@
+#include "animation.hpp"
+
+const std::map<PlayerAnimState, AnimationData> &playerAnimations()
+{
+    // Animation data initialization (Corrected Stand index)
+    static const std::map<PlayerAnimState, AnimationData> animData = {
+        {PlayerAnimState::Stand, {64, 1, 0.18f}}, // Stand: start at 64, 1 frame
+        {PlayerAnimState::Walk, {32, 8, 0.1f}},   // Walk: start at 32, 8 frames
+        {PlayerAnimState::Jump, {42, 6, 0.1f}},   // Jump and Fall: start at 42, 6 frames
+        {PlayerAnimState::Stance, {0, 4, 0.18f}}  // Stance: start at 0, 4 frames (unused for now)
+    };
+    return animData;
+}
+
+sf::IntRect animationFrameRect(const AnimationData &data, int frame)
+{
+    int frameOverallIndex = data.startFrameIndex + frame;
+    int frameCol = frameOverallIndex % FRAMES_PER_ROW;
+    int frameRow = frameOverallIndex / FRAMES_PER_ROW;
+    return sf::IntRect({frameCol * FRAME_WIDTH, frameRow * FRAME_HEIGHT}, {FRAME_WIDTH, FRAME_HEIGHT});
+}
@@ -0,0 +1,499 @@
+#include "bot_swarm.hpp"
+#include "byte_codec.hpp"
+#include "message_stream.hpp"
+#include "metrics.hpp"
+#include "nav_graph.hpp"
+#include "protocol.hpp"
+#include "tile_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+const sf::Time BOT_TICK = sf::seconds(1.f / 60.f);
+const sf::Time BOT_CONNECT_TIMEOUT = sf::seconds(2);
+const sf::Time BOT_STUCK_TIMEOUT = sf::seconds(5); // Replan when no link completes for this long
+const sf::Time BOT_REPORT_INTERVAL = sf::seconds(5);
+const float BOT_ALIGN_TOLERANCE = 6.f; // px from a node's middle that counts as ready to leap
+const int BOT_LEAP_TIMEOUT_TICKS = 300;
+
+class BotSwarm;
+
+struct Bot : MessageSink
+{
+    explicit Bot(BotSwarm &swarm) : swarm(swarm) {}
+
+    void onMessage(PacketType type, sf::Packet &packet) override;
+    void onMapBegin(uint32_t width, uint32_t height) override;
+    void onMapTiles(std::size_t firstTile, const int32_t *tiles, std::size_t count) override;
+    void onMapEnd(bool complete) override;
+
+    BotSwarm &swarm;
+
+    sf::TcpSocket socket;
+    bool connected = false;
+    sf::Clock connectTimer;
+    MessageStream stream;
+    sf::Packet outgoing;
+    bool sendPending = false; // outgoing was only partly sent
+
+    uint32_t id = static_cast<uint32_t>(-1);
+    bool hasState = false;
+    sf::Vector2f position;
+    bool onGround = false;
+
+    std::vector<uint32_t> path; // path[step] is the node the bot is on
+    std::size_t step = 0;
+    int leapTick = -1;          // Ticks into a fall or jump, -1 when not in one
+    bool leftGround = false;    // Seen airborne during the current leap
+    sf::Clock progressTimer;
+};
+
+class BotSwarm
+{
+public:
+    explicit BotSwarm(const BotOptions &options);
+
+    int run();
+
+    // Map download: the first bot to receive one fills the shared tile map
+    void beginMap(Bot &bot, uint32_t width, uint32_t height);
+    void mapTiles(Bot &bot, std::size_t firstTile, const int32_t *tiles, std::size_t count);
+    void endMap(Bot &bot, bool complete);
+    void applyMapData(Bot &bot, sf::Packet &packet);
+    void applyPackedMapData(Bot &bot, sf::Packet &packet);
+
+private:
+    void startConnect(Bot &bot);
+    void poll(Bot &bot);
+    void steer(Bot &bot);
+    bool plan(Bot &bot, uint32_t start);
+    void sendInput(Bot &bot, const PlayerInputState &input);
+    void report(float seconds);
+
+    const BotOptions &options;
+    std::vector<std::unique_ptr<Bot>> bots;
+    uint8_t receiveBuffer[16 * 1024];
+
+    TileGrid tiles;
+    Bot *mapOwner = nullptr;
+    NavGraph graph;
+    std::unique_ptr<NavQuery> query; // Set once the graph is ready
+    std::vector<std::vector<uint32_t>> componentNodes; // Goals are drawn from the bot's own component
+    std::mt19937 random;
+
+    uint64_t plans = 0;
+    uint64_t planMicroseconds = 0;
+    uint64_t nodesExpanded = 0;
+
+    MetricCounter &inputsSent;
+    MetricCounter &pathsPlanned;
+    MetricCounter &pathFailures;
+    MetricCounter &linksCompleted;
+    MetricCounter &linksMissed;
+    MetricGauge &botsConnected;
+};
+
+// --- Bot messages ---
+
+void Bot::onMessage(PacketType type, sf::Packet &packet)
+{
+    switch (type)
+    {
+    case PacketType::Welcome:
+        packet >> id;
+        break;
+    case PacketType::PlayerState:
+    {
+        uint32_t stateId;
+        float x, y;
+        bool stateOnGround;
+        if (packet >> stateId >> x >> y >> stateOnGround && stateId == id)
+        {
+            position = {x, y};
+            onGround = stateOnGround;
+            hasState = true;
+        }
+        break;
+    }
+    case PacketType::MapData:
+        swarm.applyMapData(*this, packet);
+        break;
+    case PacketType::PackedMapData:
+        swarm.applyPackedMapData(*this, packet);
+        break;
+    default:
+        break; // Other players and shard traffic do not matter to a bot
+    }
+}
+
+void Bot::onMapBegin(uint32_t width, uint32_t height)
+{
+    swarm.beginMap(*this, width, height);
+}
+
+void Bot::onMapTiles(std::size_t firstTile, const int32_t *tiles, std::size_t count)
+{
+    swarm.mapTiles(*this, firstTile, tiles, count);
+}
+
+void Bot::onMapEnd(bool complete)
+{
+    swarm.endMap(*this, complete);
+}
+
+// --- Swarm ---
+
+BotSwarm::BotSwarm(const BotOptions &botOptions)
+    : options(botOptions), random(botOptions.seed),
+      inputsSent(metricsRegistry().counter("bot_inputs_sent_total", "Input packets sent by bots.")),
+      pathsPlanned(metricsRegistry().counter("bot_paths_planned_total", "Paths found by bots.")),
+      pathFailures(metricsRegistry().counter("bot_path_failures_total", "Goals bots could not reach.")),
+      linksCompleted(metricsRegistry().counter("bot_links_completed_total", "Navigation links bots finished.")),
+      linksMissed(metricsRegistry().counter("bot_links_missed_total", "Falls and jumps that landed elsewhere.")),
+      botsConnected(metricsRegistry().gauge("bot_connected", "Bots currently connected."))
+{
+}
+
+void BotSwarm::beginMap(Bot &bot, uint32_t width, uint32_t height)
+{
+    if (query || mapOwner)
+        return; // Every bot gets the same map; one copy is enough
+    mapOwner = &bot;
+    tiles.reset(static_cast<int>(width), static_cast<int>(height));
+}
+
+void BotSwarm::mapTiles(Bot &bot, std::size_t firstTile, const int32_t *data, std::size_t count)
+{
+    if (mapOwner != &bot || tiles.width() == 0)
+        return;
+    const std::size_t width = static_cast<std::size_t>(tiles.width());
+    while (count > 0 && firstTile / width < static_cast<std::size_t>(tiles.height()))
+    {
+        const std::size_t x = firstTile % width;
+        const std::size_t n = std::min(count, width - x);
+        tiles.setRow(static_cast<int>(firstTile / width), static_cast<int>(x), data, n);
+        firstTile += n;
+        data += n;
+        count -= n;
+    }
+}
+
+void BotSwarm::endMap(Bot &bot, bool complete)
+{
+    if (mapOwner != &bot)
+        return;
+    mapOwner = nullptr;
+    if (!complete)
+        return;
+
+    graph.loadOrBuild(tiles, MovementParams(), options.cacheDirectory);
+    query = std::make_unique<NavQuery>(graph);
+    componentNodes.clear();
+    for (uint32_t n = 0; n < graph.nodeCount(); ++n)
+    {
+        if (graph.component(n) >= componentNodes.size())
+            componentNodes.resize(graph.component(n) + 1);
+        componentNodes[graph.component(n)].push_back(n);
+    }
+}
+
+void BotSwarm::applyMapData(Bot &bot, sf::Packet &packet)
+{
+    // Small maps arrive as one message instead of streamed
+    uint32_t width, height;
+    if (query || mapOwner || !(packet >> width >> height))
+        return;
+    ByteReader reader(packet);
+    if (reader.remaining() / sizeof(int32_t) / std::max<uint32_t>(width, 1) < height)
+        return;
+    beginMap(bot, width, height);
+    std::vector<int32_t> row(width);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        reader.readArray(row.data(), row.size());
+        tiles.setRow(static_cast<int>(y), 0, row.data(), row.size());
+    }
+    endMap(bot, true);
+}
+
+void BotSwarm::applyPackedMapData(Bot &bot, sf::Packet &packet)
+{
+    if (query || mapOwner)
+        return;
+    ByteReader reader(packet);
+    mapOwner = &bot;
+    if (!tiles.read(reader))
+    {
+        mapOwner = nullptr;
+        std::cerr << "Bot received malformed packed map data" << std::endl;
+        return;
+    }
+    endMap(bot, true);
+}
+
+void BotSwarm::startConnect(Bot &bot)
+{
+    bot.socket.disconnect();
+    bot.socket.setBlocking(false);
+    bot.connected = false;
+    bot.connectTimer.restart();
+    bot.stream = MessageStream();
+    bot.sendPending = false;
+    bot.id = static_cast<uint32_t>(-1);
+    bot.hasState = false;
+    bot.path.clear();
+    bot.leapTick = -1;
+    if (bot.socket.connect(options.address, options.port) == sf::Socket::Status::Done)
+        bot.connected = true;
+}
+
+void BotSwarm::poll(Bot &bot)
+{
+    if (!bot.connected)
+    {
+        if (bot.socket.getRemoteAddress())
+            bot.connected = true;
+        else if (bot.connectTimer.getElapsedTime() >= BOT_CONNECT_TIMEOUT)
+            startConnect(bot);
+        return;
+    }
+
+    while (true)
+    {
+        std::size_t received = 0;
+        sf::Socket::Status status = bot.socket.receive(receiveBuffer, sizeof(receiveBuffer), received);
+        if (status == sf::Socket::Status::Disconnected || status == sf::Socket::Status::Error)
+        {
+            bot.stream.abort(bot);
+            startConnect(bot);
+            return;
+        }
+        if (status != sf::Socket::Status::Done || received == 0)
+            return;
+        bot.stream.feed(receiveBuffer, received, bot);
+    }
+}
+
+bool BotSwarm::plan(Bot &bot, uint32_t start)
+{
+    bot.path.clear();
+    bot.step = 0;
+    bot.leapTick = -1;
+    bot.progressTimer.restart();
+
+    // Any goal in the same component is reachable, so one search always does
+    const std::vector<uint32_t> &reachable = componentNodes[graph.component(start)];
+    if (reachable.size() < 2)
+    {
+        pathFailures.add();
+        return false;
+    }
+    uint32_t goal = start;
+    while (goal == start)
+        goal = reachable[random() % reachable.size()];
+
+    sf::Clock timer;
+    bool found = query->findPath(start, goal, bot.path);
+    planMicroseconds += static_cast<uint64_t>(timer.getElapsedTime().asMicroseconds());
+    nodesExpanded += query->lastExpanded();
+    ++plans;
+    if (!found)
+    {
+        pathFailures.add();
+        return false;
+    }
+    pathsPlanned.add();
+    return true;
+}
+
+void BotSwarm::steer(Bot &bot)
+{
+    PlayerInputState input;
+    if (!query || !bot.hasState || graph.nodeCount() == 0)
+    {
+        sendInput(bot, input);
+        return;
+    }
+
+    const int32_t here = graph.nodeAt(bot.position);
+    bool needPlan = bot.step + 1 >= bot.path.size() || bot.progressTimer.getElapsedTime() >= BOT_STUCK_TIMEOUT;
+    if (needPlan && bot.leapTick < 0)
+    {
+        if (here < 0 || !bot.onGround || !plan(bot, static_cast<uint32_t>(here)))
+        {
+            sendInput(bot, input); // Wait to land somewhere the graph knows
+            return;
+        }
+    }
+    if (bot.path.empty())
+    {
+        sendInput(bot, input);
+        return;
+    }
+
+    const uint32_t from = bot.path[bot.step];
+    const uint32_t to = bot.path[bot.step + 1];
+    const NavEdge *edge = graph.findEdge(from, to);
+    if (!edge)
+    {
+        bot.path.clear();
+        sendInput(bot, input);
+        return;
+    }
+
+    if (edge->kind == NavEdgeKind::Walk)
+    {
+        if (here == static_cast<int32_t>(to))
+        {
+            ++bot.step;
+            linksCompleted.add();
+            bot.progressTimer.restart();
+        }
+        input.left = edge->direction < 0;
+        input.right = edge->direction > 0;
+    }
+    else if (bot.leapTick < 0)
+    {
+        // Line up with the spot the link was simulated from, then take off
+        float dx = graph.nodePosition(from).x - bot.position.x;
+        if (std::abs(dx) > BOT_ALIGN_TOLERANCE || !bot.onGround)
+        {
+            input.left = dx < -BOT_ALIGN_TOLERANCE;
+            input.right = dx > BOT_ALIGN_TOLERANCE;
+        }
+        else
+        {
+            bot.leapTick = 0;
+            bot.leftGround = false;
+        }
+    }
+
+    if (bot.leapTick >= 0)
+    {
+        // Replay the link's input; the server's reply lags, so landing is only
+        // trusted after the bot has been seen in the air
+        const bool holding = bot.leapTick < edge->holdTicks;
+        input.left = holding && edge->direction < 0;
+        input.right = holding && edge->direction > 0;
+        input.jump = edge->kind == NavEdgeKind::Jump && bot.leapTick == 0;
+        ++bot.leapTick;
+        if (!bot.onGround)
+            bot.leftGround = true;
+
+        if (bot.leftGround && bot.onGround)
+        {
+            bot.leapTick = -1;
+            if (here == static_cast<int32_t>(to))
+            {
+                ++bot.step;
+                linksCompleted.add();
+                bot.progressTimer.restart();
+            }
+            else
+            {
+                linksMissed.add();
+                bot.path.clear(); // Replans from wherever it landed
+            }
+        }
+        else if (bot.leapTick > BOT_LEAP_TIMEOUT_TICKS)
+        {
+            bot.leapTick = -1;
+            linksMissed.add();
+            bot.path.clear();
+        }
+    }
+
+    sendInput(bot, input);
+}
+
+void BotSwarm::sendInput(Bot &bot, const PlayerInputState &input)
+{
+    if (!bot.connected || bot.id == static_cast<uint32_t>(-1))
+        return;
+
+    // A partly sent packet has to be finished before anything else goes out
+    if (bot.sendPending)
+    {
+        if (bot.socket.send(bot.outgoing) == sf::Socket::Status::Partial)
+            return;
+        bot.sendPending = false;
+    }
+
+    bot.outgoing.clear();
+    bot.outgoing << PacketType::PlayerInput << input;
+    sf::Socket::Status status = bot.socket.send(bot.outgoing);
+    if (status == sf::Socket::Status::Partial)
+        bot.sendPending = true;
+    if (status == sf::Socket::Status::Done)
+        inputsSent.add();
+}
+
+void BotSwarm::report(float seconds)
+{
+    std::size_t connected = 0;
+    for (const auto &bot : bots)
+        connected += bot->connected ? 1 : 0;
+    botsConnected.set(static_cast<double>(connected));
+
+    std::cout << "[bots " << seconds << " s] connected " << connected << "/" << bots.size() << ", inputs "
+              << inputsSent.get() << ", links " << linksCompleted.get() << " done / " << linksMissed.get()
+              << " missed, paths " << pathsPlanned.get() << " (" << pathFailures.get() << " failed)";
+    if (plans > 0)
+        std::cout << ", " << planMicroseconds / plans << " us and " << nodesExpanded / plans << " nodes per search";
+    std::cout << std::endl;
+}
+
+int BotSwarm::run()
+{
+    bots.reserve(options.count);
+    for (uint32_t i = 0; i < options.count; ++i)
+    {
+        bots.push_back(std::make_unique<Bot>(*this));
+        startConnect(*bots.back());
+    }
+    std::cout << "Started " << bots.size() << " bots against " << options.address.toString() << ":" << options.port
+              << std::endl;
+
+    sf::Clock runClock;
+    sf::Clock reportClock;
+    sf::Time nextTick = sf::Time::Zero;
+    while (options.durationSeconds <= 0.f || runClock.getElapsedTime().asSeconds() < options.durationSeconds)
+    {
+        for (auto &bot : bots)
+            poll(*bot);
+        for (auto &bot : bots)
+        {
+            if (bot->connected)
+                steer(*bot);
+        }
+
+        if (reportClock.getElapsedTime() >= BOT_REPORT_INTERVAL)
+        {
+            reportClock.restart();
+            report(runClock.getElapsedTime().asSeconds());
+        }
+
+        // Fixed input rate, like a player client running at 60 fps
+        nextTick += BOT_TICK;
+        sf::Time now = runClock.getElapsedTime();
+        if (nextTick > now)
+            sf::sleep(nextTick - now);
+        else
+            nextTick = now;
+    }
+
+    report(runClock.getElapsedTime().asSeconds());
+    return query ? 0 : 1;
+}
+} // namespace
+
+int runBotSwarm(const BotOptions &options)
+{
+    BotSwarm swarm(options);
+    return swarm.run();
+}
@@ -0,0 +1,229 @@
+#include "byte_codec.hpp"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BYTE_CODEC_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define BYTE_CODEC_NEON
+#endif
+
+namespace
+{
+bool hostIsBigEndian()
+{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+    return __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+#else
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 0;
+#endif
+}
+
+template <std::size_t Size>
+void byteSwapScalar(uint8_t *dst, const uint8_t *src, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i, dst += Size, src += Size)
+    {
+        uint8_t element[Size];
+        for (std::size_t b = 0; b < Size; ++b)
+            element[b] = src[Size - 1 - b];
+        std::memcpy(dst, element, Size);
+    }
+}
+
+#if defined(BYTE_CODEC_SSE2)
+// SSE2 has no byte shuffle: swap bytes inside 16-bit lanes with shifts, then
+// reorder the lanes with word/dword shuffles.
+inline __m128i swapBytesIn16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+inline __m128i swapBytesIn32(__m128i v)
+{
+    v = swapBytesIn16(v);
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+inline __m128i swapBytesIn64(__m128i v)
+{
+    return _mm_shuffle_epi32(swapBytesIn32(v), _MM_SHUFFLE(2, 3, 0, 1));
+}
+#endif
+} // namespace
+
+// Each vector loop handles 16 bytes at a time and leaves the tail to the scalar loop
+void byteSwapCopy16(void *dst, const void *src, std::size_t count)
+{
+    auto *out = static_cast<uint8_t *>(dst);
+    auto *in = static_cast<const uint8_t *>(src);
+    std::size_t i = 0;
+#if defined(BYTE_CODEC_SSE2)
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2),
+                         swapBytesIn16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2))));
+#elif defined(BYTE_CODEC_NEON)
+    for (; i + 8 <= count; i += 8)
+        vst1q_u8(out + i * 2, vrev16q_u8(vld1q_u8(in + i * 2)));
+#endif
+    byteSwapScalar<2>(out + i * 2, in + i * 2, count - i);
+}
+
+void byteSwapCopy32(void *dst, const void *src, std::size_t count)
+{
+    auto *out = static_cast<uint8_t *>(dst);
+    auto *in = static_cast<const uint8_t *>(src);
+    std::size_t i = 0;
+#if defined(BYTE_CODEC_SSE2)
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4),
+                         swapBytesIn32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4))));
+#elif defined(BYTE_CODEC_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1q_u8(out + i * 4, vrev32q_u8(vld1q_u8(in + i * 4)));
+#endif
+    byteSwapScalar<4>(out + i * 4, in + i * 4, count - i);
+}
+
+void byteSwapCopy64(void *dst, const void *src, std::size_t count)
+{
+    auto *out = static_cast<uint8_t *>(dst);
+    auto *in = static_cast<const uint8_t *>(src);
+    std::size_t i = 0;
+#if defined(BYTE_CODEC_SSE2)
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 8),
+                         swapBytesIn64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 8))));
+#elif defined(BYTE_CODEC_NEON)
+    for (; i + 2 <= count; i += 2)
+        vst1q_u8(out + i * 8, vrev64q_u8(vld1q_u8(in + i * 8)));
+#endif
+    byteSwapScalar<8>(out + i * 8, in + i * 8, count - i);
+}
+
+void networkToHost(void *dst, const void *src, std::size_t count, std::size_t size)
+{
+    if (size == 1 || hostIsBigEndian())
+    {
+        if (dst != src)
+            std::memmove(dst, src, count * size);
+        return;
+    }
+    switch (size)
+    {
+    case 2:
+        byteSwapCopy16(dst, src, count);
+        break;
+    case 4:
+        byteSwapCopy32(dst, src, count);
+        break;
+    case 8:
+        byteSwapCopy64(dst, src, count);
+        break;
+    }
+}
+
+// --- ByteReader ---
+
+ByteReader::ByteReader(const void *bytes, std::size_t length)
+    : data(static_cast<const uint8_t *>(bytes)), size(length)
+{
+}
+
+ByteReader::ByteReader(const sf::Packet &packet)
+    : data(static_cast<const uint8_t *>(packet.getData())), size(packet.getDataSize()),
+      offset(packet.getReadPosition()), ok(static_cast<bool>(packet))
+{
+    if (offset > size)
+        offset = size;
+}
+
+const uint8_t *ByteReader::take(std::size_t bytes)
+{
+    if (!ok || bytes > size - offset)
+    {
+        ok = false;
+        return nullptr;
+    }
+    const uint8_t *result = data + offset;
+    offset += bytes;
+    return result;
+}
+
+ByteReader &ByteReader::skip(std::size_t bytes)
+{
+    take(bytes);
+    return *this;
+}
+
+ByteReader &ByteReader::operator>>(bool &value)
+{
+    uint8_t byte = 0;
+    if (*this >> byte)
+        value = byte != 0;
+    return *this;
+}
+
+ByteReader &ByteReader::operator>>(uint8_t &value)
+{
+    return readArray(&value, 1);
+}
+
+ByteReader &ByteReader::operator>>(int32_t &value)
+{
+    return readArray(&value, 1);
+}
+
+ByteReader &ByteReader::operator>>(uint32_t &value)
+{
+    return readArray(&value, 1);
+}
+
+ByteReader &ByteReader::operator>>(int64_t &value)
+{
+    return readArray(&value, 1);
+}
+
+ByteReader &ByteReader::operator>>(float &value)
+{
+    // sf::Packet writes floats as raw host bytes
+    if (const uint8_t *source = take(sizeof(value)))
+        std::memcpy(&value, source, sizeof(value));
+    return *this;
+}
+
+// --- Writing ---
+
+template <typename T>
+void writeArray(sf::Packet &packet, const T *source, std::size_t count)
+{
+    static_assert(std::is_integral<T>::value, "writeArray encodes integers");
+    if (sizeof(T) == 1 || hostIsBigEndian())
+    {
+        packet.append(source, count * sizeof(T));
+        return;
+    }
+
+    // Convert through a small stack buffer so large arrays need no scratch allocation
+    const std::size_t CHUNK = 4096 / sizeof(T);
+    T staging[4096 / sizeof(T)];
+    for (std::size_t done = 0; done < count; done += CHUNK)
+    {
+        std::size_t n = count - done < CHUNK ? count - done : CHUNK;
+        networkToHost(staging, source + done, n, sizeof(T)); // Swapping is its own inverse
+        packet.append(staging, n * sizeof(T));
+    }
+}
+
+template void writeArray<int32_t>(sf::Packet &, const int32_t *, std::size_t);
+template void writeArray<uint32_t>(sf::Packet &, const uint32_t *, std::size_t);
+template void writeArray<int16_t>(sf::Packet &, const int16_t *, std::size_t);
+template void writeArray<uint16_t>(sf::Packet &, const uint16_t *, std::size_t);
+template void writeArray<int64_t>(sf::Packet &, const int64_t *, std::size_t);
+template void writeArray<uint64_t>(sf::Packet &, const uint64_t *, std::size_t);
+template void writeArray<uint8_t>(sf::Packet &, const uint8_t *, std::size_t);
@@ -0,0 +1,213 @@
+#include "channel_benchmark.hpp"
+#include "byte_codec.hpp"
+#include "channel_mux.hpp"
+#include "message_stream.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace
+{
+const double LINK_BYTES_PER_SECOND = 2.0 * 1024 * 1024;
+const double LINK_BURST_BYTES = 4 * 1024; // Unused allowance kept across sleeps
+const uint32_t MAP_SIDE = 1024;           // 4 MiB of tiles
+const float STATE_RATE = 60.f;
+const float MAP_AT_SECONDS = 0.5f;
+const uint32_t STATE_COUNT = 210; // 3.5 s, past the end of the map transfer
+
+int32_t mapTile(std::size_t index)
+{
+    return static_cast<int32_t>(index % 7 == 0);
+}
+
+struct RunResult
+{
+    std::vector<float> latencies; // Seconds from queueing a state to its delivery
+    float longestGap = 0.f;       // Seconds between consecutive state deliveries
+    float mapSeconds = 0.f;       // From queueing the map to its last tile
+    bool mapComplete = false;
+    bool mapIntact = true; // Every tile arrived at its index with the value sent
+    bool failed = false;
+};
+
+// Plays the server: PlayerState at STATE_RATE carrying its queue time as x,
+// and one large MapData, written no faster than the emulated link allows
+void serveSession(sf::TcpListener &listener, bool channels, const sf::Clock &clock, std::atomic<float> &mapQueuedAt,
+                  std::atomic<bool> &failed)
+{
+    sf::TcpSocket socket;
+    if (listener.accept(socket) != sf::Socket::Status::Done)
+    {
+        failed = true;
+        return;
+    }
+    socket.setBlocking(false);
+
+    // One channel and no slicing is what sending packets in order amounts to
+    ChannelMux mux(channels ? DEFAULT_SLICE_SIZE : std::numeric_limits<std::size_t>::max());
+    auto queue = [&](const sf::Packet &packet) {
+        if (channels)
+            mux.push(packet);
+        else
+            mux.push(MessageChannel::Realtime, packet);
+    };
+
+    std::vector<int32_t> tiles(static_cast<std::size_t>(MAP_SIDE) * MAP_SIDE);
+    for (std::size_t i = 0; i < tiles.size(); ++i)
+        tiles[i] = mapTile(i);
+    sf::Packet map;
+    map << PacketType::MapData << MAP_SIDE << MAP_SIDE;
+    writeArray(map, tiles.data(), tiles.size());
+
+    uint32_t nextState = 0;
+    bool mapQueued = false;
+    double allowance = 0.0;
+    float lastRefill = clock.getElapsedTime().asSeconds();
+    while (nextState < STATE_COUNT || !mapQueued || !mux.empty())
+    {
+        const float now = clock.getElapsedTime().asSeconds();
+        while (nextState < STATE_COUNT && now >= static_cast<float>(nextState) / STATE_RATE)
+        {
+            sf::Packet state;
+            state << PacketType::PlayerState << nextState++ << now << 0.f << true;
+            queue(state);
+        }
+        if (!mapQueued && now >= MAP_AT_SECONDS)
+        {
+            queue(map);
+            mapQueuedAt = now;
+            mapQueued = true;
+        }
+
+        allowance = std::min(LINK_BURST_BYTES, allowance + (now - lastRefill) * LINK_BYTES_PER_SECOND);
+        lastRefill = now;
+        const uint64_t before = mux.totalSent();
+        if (!mux.flush(socket, static_cast<std::size_t>(allowance)))
+        {
+            failed = true;
+            return;
+        }
+        allowance -= static_cast<double>(mux.totalSent() - before);
+        sf::sleep(sf::milliseconds(1));
+    }
+}
+
+class ReceiverSink : public MessageSink
+{
+public:
+    ReceiverSink(const sf::Clock &clock, RunResult &result) : clock(clock), result(result) {}
+
+    void onMessage(PacketType type, sf::Packet &packet) override
+    {
+        uint32_t id;
+        float queuedAt, y;
+        bool onGround;
+        if (type != PacketType::PlayerState || !(packet >> id >> queuedAt >> y >> onGround))
+            return;
+        const float now = clock.getElapsedTime().asSeconds();
+        result.latencies.push_back(now - queuedAt);
+        if (lastState > 0.f)
+            result.longestGap = std::max(result.longestGap, now - lastState);
+        lastState = now;
+    }
+    void onMapBegin(uint32_t, uint32_t) override {}
+    void onMapTiles(std::size_t first, const int32_t *tiles, std::size_t count) override
+    {
+        result.mapIntact = result.mapIntact && first == tilesSeen;
+        for (std::size_t i = 0; i < count; ++i)
+            result.mapIntact = result.mapIntact && tiles[i] == mapTile(first + i);
+        tilesSeen = first + count;
+    }
+    void onMapEnd(bool complete) override
+    {
+        result.mapComplete = complete && tilesSeen == static_cast<std::size_t>(MAP_SIDE) * MAP_SIDE;
+        mapEndedAt = clock.getElapsedTime().asSeconds();
+    }
+
+    float mapEndedAt = 0.f;
+
+private:
+    const sf::Clock &clock;
+    RunResult &result;
+    float lastState = 0.f;
+    std::size_t tilesSeen = 0;
+};
+
+RunResult runSession(bool channels)
+{
+    RunResult result;
+    sf::TcpListener listener;
+    if (listener.listen(sf::Socket::AnyPort, sf::IpAddress::LocalHost) != sf::Socket::Status::Done)
+    {
+        std::cerr << "Channel benchmark: cannot listen on loopback" << std::endl;
+        result.failed = true;
+        return result;
+    }
+
+    const sf::Clock clock;
+    std::atomic<float> mapQueuedAt{0.f};
+    std::atomic<bool> serverFailed{false};
+    std::thread server(serveSession, std::ref(listener), channels, std::cref(clock), std::ref(mapQueuedAt),
+                       std::ref(serverFailed));
+
+    sf::TcpSocket socket;
+    ReceiverSink sink(clock, result);
+    MessageStream stream;
+    if (socket.connect(sf::IpAddress::LocalHost, listener.getLocalPort(), sf::seconds(5.f)) ==
+        sf::Socket::Status::Done)
+    {
+        std::vector<uint8_t> buffer(16 * 1024);
+        std::size_t received = 0;
+        while (socket.receive(buffer.data(), buffer.size(), received) == sf::Socket::Status::Done)
+            stream.feed(buffer.data(), received, sink);
+        stream.abort(sink);
+    }
+    server.join();
+
+    result.failed = serverFailed || result.latencies.size() != STATE_COUNT || !result.mapComplete || !result.mapIntact;
+    result.mapSeconds = sink.mapEndedAt - mapQueuedAt;
+    return result;
+}
+
+float percentile(const std::vector<float> &sorted, double fraction)
+{
+    return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5))];
+}
+
+void report(const char *name, RunResult &result)
+{
+    std::cout << "  " << name << ": ";
+    if (result.latencies.empty())
+    {
+        std::cout << "no states delivered" << std::endl;
+        return;
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    std::cout << "states " << result.latencies.size() << "/" << STATE_COUNT << ", latency ms p50 "
+              << percentile(result.latencies, 0.5) * 1000.f << ", p99 " << percentile(result.latencies, 0.99) * 1000.f
+              << ", max " << result.latencies.back() * 1000.f << ", longest gap " << result.longestGap * 1000.f
+              << " ms, map " << (result.mapComplete ? result.mapSeconds : 0.f) << " s" << std::endl;
+}
+} // namespace
+
+int runChannelBenchmark()
+{
+    std::cout << "Channel benchmark: " << MAP_SIDE * MAP_SIDE * sizeof(int32_t) / (1024 * 1024) << " MiB map over a "
+              << LINK_BYTES_PER_SECOND / (1024 * 1024) << " MiB/s link, " << STATE_RATE << " Hz states, "
+              << DEFAULT_SLICE_SIZE / 1024 << " KiB slices" << std::endl;
+
+    RunResult fifo = runSession(false);
+    report("fifo", fifo);
+    RunResult channels = runSession(true);
+    report("channels", channels);
+
+    if (fifo.failed || channels.failed)
+    {
+        std::cout << "FAIL: messages lost or the map did not arrive intact" << std::endl;
+        return 1;
+    }
+    return 0;
+}
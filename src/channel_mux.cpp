@@ -0,0 +1,107 @@
+#include "channel_mux.hpp"
+#include "byte_codec.hpp"
+#include <algorithm>
+
+ChannelMux::ChannelMux(std::size_t sliceSize) : sliceSize(std::max(sliceSize, SLICE_HEAD_SIZE + 1))
+{
+}
+
+void ChannelMux::push(const sf::Packet &packet)
+{
+    const MessageChannel channel =
+        packet.getDataSize() > 0 ? channelFor(static_cast<PacketType>(*static_cast<const uint8_t *>(packet.getData())))
+                                 : MessageChannel::Realtime;
+    push(channel, packet);
+}
+
+void ChannelMux::push(MessageChannel channel, const sf::Packet &packet)
+{
+    const uint32_t size = static_cast<uint32_t>(packet.getDataSize());
+    std::vector<uint8_t> frame(sizeof(size) + size);
+    networkToHost(frame.data(), &size, 1, sizeof(size)); // Swapping is its own inverse
+    if (size > 0)
+        std::copy_n(static_cast<const uint8_t *>(packet.getData()), size, frame.data() + sizeof(size));
+
+    Queue &queue = queues[static_cast<uint8_t>(channel)];
+    queue.bytes += frame.size();
+    queue.frames.push_back(std::move(frame));
+}
+
+bool ChannelMux::nextUnit()
+{
+    for (uint8_t i = 0; i < MESSAGE_CHANNEL_COUNT; ++i)
+    {
+        Queue &queue = queues[i];
+        if (queue.frames.empty())
+            continue;
+
+        std::vector<uint8_t> &frame = queue.frames.front();
+        if (queue.offset == 0 && frame.size() <= sliceSize)
+        {
+            wire.swap(frame);
+            queue.bytes -= wire.size();
+            queue.frames.pop_front();
+            return true;
+        }
+
+        const std::size_t n = std::min(sliceSize - SLICE_HEAD_SIZE, frame.size() - queue.offset);
+        const uint32_t size = static_cast<uint32_t>(n + 2);
+        wire.resize(SLICE_HEAD_SIZE + n);
+        networkToHost(wire.data(), &size, 1, sizeof(size));
+        wire[4] = static_cast<uint8_t>(PacketType::ChannelData);
+        wire[5] = i;
+        std::copy_n(frame.data() + queue.offset, n, wire.data() + SLICE_HEAD_SIZE);
+        queue.offset += n;
+        queue.bytes -= n;
+        if (queue.offset == frame.size())
+        {
+            queue.offset = 0;
+            queue.frames.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ChannelMux::flush(sf::TcpSocket &socket, std::size_t maxBytes)
+{
+    while (maxBytes > 0)
+    {
+        if (wireSent == wire.size())
+        {
+            wire.clear();
+            wireSent = 0;
+            if (!nextUnit())
+                return true;
+        }
+
+        std::size_t sent = 0;
+        const std::size_t n = std::min(maxBytes, wire.size() - wireSent);
+        const sf::Socket::Status status = socket.send(wire.data() + wireSent, n, sent);
+        wireSent += sent;
+        bytesSent += sent;
+        maxBytes -= sent;
+        if (status == sf::Socket::Status::Disconnected || status == sf::Socket::Status::Error)
+            return false;
+        if (status != sf::Socket::Status::Done)
+            return true; // NotReady or Partial: the socket buffer is full
+    }
+    return true;
+}
+
+std::size_t ChannelMux::queuedBytes(MessageChannel channel) const
+{
+    return queues[static_cast<uint8_t>(channel)].bytes;
+}
+
+bool ChannelMux::empty() const
+{
+    if (wireSent < wire.size())
+        return false;
+    for (const Queue &queue : queues)
+    {
+        if (!queue.frames.empty())
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,495 @@
+#include "client_world.hpp"
+#include "byte_codec.hpp"
+#include <algorithm>
+#include <cmath> // For std::abs
+#include <iostream>
+#include <utility>
+
+ClientWorld::ClientWorld(const sf::Texture &texture)
+    : playerTexture(texture), playerSprite(texture), otherPlayers(texture)
+{
+    playerSprite.setOrigin({FRAME_WIDTH / 2.f, FRAME_HEIGHT / 2.f}); // Bottom-center origin
+    playerSprite.setPosition({400.f, 300.f});                        // Initial position
+}
+
+static bool applyWelcome(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t receivedId; // Use different variable name
+    if (!(packet >> receivedId))
+    { /* Error */
+        return false;
+    }
+    if (shardId != world.myShardId)
+    {
+        return true; // Neighbour shards greet us too; our id comes from the authority
+    }
+    world.myPlayerId = receivedId; // Store the received ID
+    if (world.logEvents)
+        std::cout << "Welcome! Your player ID is: " << world.myPlayerId << std::endl;
+    return true;
+}
+
+static bool applyPlayerState(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t id;
+    float x, y;
+    bool isOnGround; // Only receive needed flags
+    if (!(packet >> id >> x >> y >> isOnGround))
+    {
+        std::cerr << "Failed to read player state" << std::endl;
+        return false;
+    }
+
+    if (id == world.myPlayerId)
+    {
+        if (shardId != world.myShardId)
+            return true;
+        world.myIsOnGround = isOnGround; // Update ground state
+        world.playerSprite.setPosition({x, y});
+        return true;
+    }
+
+    // 플레이어가 맵에 존재하는지 확인 및 없으면 생성
+    RemotePlayer *player = world.otherPlayers.find(id);
+    if (!player)
+    {
+        player = &world.otherPlayers.insert(id);
+        player->authorityShard = shardId;
+        if (world.logEvents)
+            std::cout << "Created other player sprite: " << id << std::endl;
+    }
+    else if (player->authorityShard != shardId)
+    {
+        return true; // Mirrored by a neighbour shard; the authority's copy wins
+    }
+
+    // 이전 X 좌표 저장 (방향 비교용)
+    float otherPrevX = player->sprite.getPosition().x;
+
+    // 위치 업데이트
+    player->sprite.setPosition({x, y});
+    player->onGround = isOnGround;
+
+    // 방향(FacingRight) 업데이트
+    if (x > otherPrevX)
+    {
+        player->facingRight = true; // 오른쪽으로 이동
+    }
+    else if (x < otherPrevX)
+    {
+        player->facingRight = false; // 왼쪽으로 이동
+    }
+
+    // 5. 애니메이션 상태 업데이트 (기존 로직)
+    PlayerAnimState targetOtherState = player->animState; // 현재 상태 유지 기본값
+    if (!isOnGround)
+    {
+        targetOtherState = PlayerAnimState::Jump;
+    }
+    else if (std::abs(x - otherPrevX) > 0.1f)
+    { // 이동 감지 시 Walk (임계값 조정 가능)
+        targetOtherState = PlayerAnimState::Walk;
+    }
+    else
+    { // 땅에 있고 움직임 없으면 Stand
+        targetOtherState = PlayerAnimState::Stand;
+    }
+
+    // 상태 변경 시 프레임 리셋
+    if (player->animState != targetOtherState)
+    {
+        player->currentFrame = 0;
+        player->animTimer = sf::Time::Zero;
+    }
+    player->animState = targetOtherState;
+    return true;
+}
+
+static bool applyPlayerJoined(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t id;
+    float x, y;
+    bool onGround; // Assume server sends initial state too
+    // FIX: Adjust parsing if server sends less/more data on join
+    if (!(packet >> id >> x >> y >> onGround))
+    { /* Error */
+        return false;
+    }
+    if (id != world.myPlayerId && !world.otherPlayers.find(id))
+    { // Add check if already exists
+        RemotePlayer &player = world.otherPlayers.insert(id);
+        player.sprite.setPosition({x, y});
+        player.onGround = onGround;
+        player.animState = onGround ? PlayerAnimState::Stand : PlayerAnimState::Jump; // Set initial state
+        player.authorityShard = shardId;
+        if (world.logEvents)
+            std::cout << "Player " << id << " joined." << std::endl;
+    }
+    return true;
+}
+
+static bool applyPlayerLeft(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t id;
+    if (!(packet >> id))
+    { /* Error */
+        return false;
+    }
+    RemotePlayer *player = world.otherPlayers.find(id);
+    if (!player || player->authorityShard != shardId)
+    {
+        return true; // Left a neighbour's view, not the world
+    }
+    if (world.otherPlayers.erase(id))
+    { // Remove and check if successful
+        if (world.logEvents)
+            std::cout << "Player " << id << " left." << std::endl;
+    }
+    return true;
+}
+
+static void appendRowShapes(ClientWorld &world, int y, const int32_t *row)
+{
+    for (int x = 0; x < world.clientMapWidth; ++x)
+    {
+        // 렌더링할 타일 Shape 생성 (벽만 그리기)
+        if (row[x] == 1)
+        {
+            sf::RectangleShape tileShape({CLIENT_TILE_SIZE, CLIENT_TILE_SIZE});
+            tileShape.setPosition({x * CLIENT_TILE_SIZE, y * CLIENT_TILE_SIZE});
+            tileShape.setFillColor(sf::Color::White); // 벽 색상
+            world.mapShapes.push_back(tileShape);
+        }
+    }
+}
+
+static bool applyMapData(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t width, height;
+    if (!(packet >> width >> height))
+    {
+        std::cerr << "Error: Could not parse map dimensions" << std::endl;
+        return false;
+    }
+    if (shardId != world.myShardId)
+    {
+        return true; // Only the authoritative shard's map is shown
+    }
+
+    // Tiles are decoded a row at a time and packed into the tile map
+    ByteReader reader(packet);
+    if (reader.remaining() / sizeof(int32_t) / std::max<uint32_t>(width, 1) < height)
+    {
+        std::cerr << "Error: Could not parse map data content" << std::endl;
+        return false;
+    }
+    beginMap(world, width, height);
+    std::vector<int32_t> row(width);
+    for (int y = 0; y < world.clientMapHeight; ++y)
+    {
+        reader.readArray(row.data(), row.size());
+        world.incomingTiles.setRow(y, 0, row.data(), row.size());
+        appendRowShapes(world, y, row.data());
+    }
+    endMap(world, true);
+    return true;
+}
+
+static bool applyPackedMapData(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    if (shardId != world.myShardId)
+    {
+        return true; // Only the authoritative shard's map is shown
+    }
+
+    // Decoded into a scratch grid so a malformed message leaves the current map alone
+    TileGrid tiles;
+    ByteReader reader(packet);
+    if (!tiles.read(reader))
+    {
+        std::cerr << "Error: Could not parse packed map data" << std::endl;
+        return false;
+    }
+    beginMap(world, static_cast<uint32_t>(tiles.width()), static_cast<uint32_t>(tiles.height()));
+    world.incomingTiles = std::move(tiles);
+    endMap(world, true);
+    rebuildMapShapes(world);
+    return true;
+}
+
+static bool applyShardHandoff(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t id, newShardId;
+    if (!(packet >> id >> newShardId))
+    {
+        std::cerr << "Failed to read shard handoff" << std::endl;
+        return false;
+    }
+
+    if (id == world.myPlayerId)
+    {
+        // Only the shard that currently owns us may hand us off
+        if (shardId == world.myShardId && newShardId != world.myShardId)
+        {
+            world.myShardId = newShardId;
+            if (world.logEvents)
+                std::cout << "Handed off to shard " << newShardId << std::endl;
+        }
+        return true;
+    }
+
+    RemotePlayer *player = world.otherPlayers.find(id);
+    if (player && player->authorityShard == shardId)
+    {
+        player->authorityShard = newShardId;
+    }
+    return true;
+}
+
+static bool applyShardInfo(ClientWorld &world, sf::Packet &packet, uint32_t shardId)
+{
+    uint32_t senderId;
+    if (!(packet >> senderId))
+    {
+        std::cerr << "Failed to read shard info" << std::endl;
+        return false;
+    }
+    // The first connection is known as INITIAL_SHARD_ID until the authority
+    // names itself. The neighbour list is connection management (ShardSet).
+    if (shardId == world.myShardId && senderId != shardId)
+        relabelShard(world, shardId, senderId);
+    return true;
+}
+
+bool applyPacket(ClientWorld &world, PacketType type, sf::Packet &packet, uint32_t shardId)
+{
+    switch (type)
+    {
+    case PacketType::Welcome:
+        return applyWelcome(world, packet, shardId);
+    case PacketType::PlayerState:
+        return applyPlayerState(world, packet, shardId);
+    case PacketType::PlayerJoined:
+        return applyPlayerJoined(world, packet, shardId);
+    case PacketType::PlayerLeft:
+        return applyPlayerLeft(world, packet, shardId);
+    case PacketType::MapData:
+        return applyMapData(world, packet, shardId);
+    case PacketType::PackedMapData:
+        return applyPackedMapData(world, packet, shardId);
+    case PacketType::ShardHandoff:
+        return applyShardHandoff(world, packet, shardId);
+    case PacketType::ShardInfo:
+        return applyShardInfo(world, packet, shardId);
+    default:
+        std::cerr << "Unknown packet type: " << static_cast<int>(type) << std::endl;
+        return false;
+    }
+}
+
+void rebuildMapShapes(ClientWorld &world)
+{
+    world.mapShapes.clear(); // 이전 맵 데이터 클리어
+    TileReadGuard guard(world.clientTileMap);
+    std::vector<int32_t> row(static_cast<std::size_t>(guard.tiles().width()));
+    for (int y = 0; y < guard.tiles().height(); ++y)
+    {
+        guard.tiles().unpackRow(y, row.data());
+        appendRowShapes(world, y, row.data());
+    }
+}
+
+void beginMap(ClientWorld &world, uint32_t width, uint32_t height)
+{
+    world.clientMapWidth = static_cast<int>(width);
+    world.clientMapHeight = static_cast<int>(height);
+    world.clientTileMap.reset(world.clientMapWidth, world.clientMapHeight);
+    world.incomingTiles.reset(world.clientMapWidth, world.clientMapHeight);
+    world.mapShapes.clear(); // 이전 맵 데이터 클리어
+    world.mapLoaded = false;
+}
+
+void applyMapTiles(ClientWorld &world, std::size_t firstTile, const int32_t *tiles, std::size_t count)
+{
+    const std::size_t width = static_cast<std::size_t>(world.incomingTiles.width());
+    std::vector<int32_t> row;
+    while (count > 0 && width > 0)
+    {
+        std::size_t y = firstTile / width;
+        std::size_t x = firstTile % width;
+        if (y >= static_cast<std::size_t>(world.incomingTiles.height()))
+            break;
+        std::size_t n = std::min(count, width - x);
+        world.incomingTiles.setRow(static_cast<int>(y), static_cast<int>(x), tiles, n);
+        if (x + n == width)
+        {
+            if (x == 0)
+            {
+                appendRowShapes(world, static_cast<int>(y), tiles);
+            }
+            else
+            {
+                // The row started in an earlier call
+                row.resize(width);
+                world.incomingTiles.unpackRow(static_cast<int>(y), row.data());
+                appendRowShapes(world, static_cast<int>(y), row.data());
+            }
+        }
+        firstTile += n;
+        tiles += n;
+        count -= n;
+    }
+}
+
+void endMap(ClientWorld &world, bool complete)
+{
+    if (!complete)
+    {
+        world.incomingTiles = TileGrid(); // Releases the buffer
+        std::cerr << "Error: Map data ended early" << std::endl;
+        return;
+    }
+    world.clientTileMap.assign(world.incomingTiles);
+    world.incomingTiles = TileGrid();
+    world.mapLoaded = true;
+    if (world.logEvents)
+    {
+        TileReadGuard guard(world.clientTileMap);
+        const TileMapVersion &tiles = guard.tiles();
+        const std::size_t unpacked = static_cast<std::size_t>(tiles.width()) * tiles.height() * sizeof(int32_t);
+        std::cout << "Map data loaded (" << world.clientMapWidth << "x" << world.clientMapHeight << ", "
+                  << tiles.chunkCount() << " chunks: " << tiles.memoryBytes() << " bytes instead of " << unpacked
+                  << ")" << std::endl;
+    }
+}
+
+void writeMapData(const ClientWorld &world, sf::Packet &packet)
+{
+    TileGrid tiles;
+    {
+        TileReadGuard guard(world.clientTileMap);
+        guard.tiles().copyTo(tiles);
+    }
+    packet << PacketType::PackedMapData;
+    tiles.write(packet);
+}
+
+void dropShardPlayers(ClientWorld &world, uint32_t shardId)
+{
+    std::vector<uint32_t> lost;
+    for (const auto &player : world.otherPlayers)
+    {
+        if (player.authorityShard == shardId)
+            lost.push_back(player.id);
+    }
+    for (uint32_t id : lost)
+    {
+        world.otherPlayers.erase(id);
+    }
+}
+
+void relabelShard(ClientWorld &world, uint32_t fromShardId, uint32_t toShardId)
+{
+    if (world.myShardId == fromShardId)
+        world.myShardId = toShardId;
+    for (auto &player : world.otherPlayers)
+    {
+        if (player.authorityShard == fromShardId)
+            player.authorityShard = toShardId;
+    }
+}
+
+// --- Snapshots ---
+
+void writeSnapshot(const ClientWorld &world, sf::Packet &packet)
+{
+    TileGrid tiles;
+    {
+        TileReadGuard guard(world.clientTileMap);
+        guard.tiles().copyTo(tiles);
+    }
+    packet << world.mapLoaded;
+    tiles.write(packet);
+
+    sf::Vector2f position = world.playerSprite.getPosition();
+    packet << world.myPlayerId << position.x << position.y << world.myIsOnGround << world.myShardId;
+
+    packet << static_cast<uint32_t>(world.otherPlayers.size());
+    for (const auto &player : world.otherPlayers)
+    {
+        sf::Vector2f otherPosition = player.sprite.getPosition();
+        packet << player.id << otherPosition.x << otherPosition.y << static_cast<uint8_t>(player.animState)
+               << static_cast<int32_t>(player.currentFrame) << static_cast<int64_t>(player.animTimer.asMicroseconds())
+               << player.facingRight << player.onGround << player.authorityShard;
+    }
+}
+
+bool readSnapshot(ClientWorld &world, sf::Packet &packet, const SnapshotFormat &format)
+{
+    ByteReader reader(packet);
+    if (!(reader >> world.mapLoaded))
+        return false;
+    TileGrid tiles;
+    if (format.packedTiles)
+    {
+        if (!tiles.read(reader))
+            return false;
+    }
+    else
+    {
+        uint32_t width, height;
+        if (!(reader >> width >> height) || reader.remaining() / sizeof(int32_t) / std::max<uint32_t>(width, 1) < height)
+            return false;
+        tiles.reset(static_cast<int>(width), static_cast<int>(height));
+        std::vector<int32_t> row(width);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            reader.readArray(row.data(), row.size());
+            tiles.setRow(static_cast<int>(y), 0, row.data(), row.size());
+        }
+    }
+    world.clientTileMap.assign(tiles);
+    world.clientMapWidth = tiles.width();
+    world.clientMapHeight = tiles.height();
+    rebuildMapShapes(world);
+
+    float x, y;
+    if (!(reader >> world.myPlayerId >> x >> y >> world.myIsOnGround))
+        return false;
+    world.myShardId = INITIAL_SHARD_ID;
+    if (format.shardIds && !(reader >> world.myShardId))
+        return false;
+    world.playerSprite.setPosition({x, y});
+
+    uint32_t count;
+    if (!(reader >> count))
+        return false;
+    world.otherPlayers.clear();
+    const auto &animData = playerAnimations();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t id;
+        uint8_t animState;
+        int32_t frame;
+        int64_t timerMicros;
+        bool facingRight, onGround;
+        uint32_t authorityShard = INITIAL_SHARD_ID;
+        if (!(reader >> id >> x >> y >> animState >> frame >> timerMicros >> facingRight >> onGround))
+            return false;
+        if (format.shardIds && !(reader >> authorityShard))
+            return false;
+        if (animState > static_cast<uint8_t>(PlayerAnimState::Stance) || world.otherPlayers.find(id))
+            return false; // insert() requires a new id
+
+        RemotePlayer &player = world.otherPlayers.insert(id);
+        player.sprite.setPosition({x, y});
+        player.animState = static_cast<PlayerAnimState>(animState);
+        player.currentFrame = frame;
+        player.animTimer = sf::microseconds(timerMicros);
+        player.facingRight = facingRight;
+        player.onGround = onGround;
+        player.authorityShard = authorityShard;
+        player.sprite.setTextureRect(animationFrameRect(animData.at(player.animState), player.currentFrame));
+    }
+    return true;
+}
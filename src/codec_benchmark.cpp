@@ -0,0 +1,79 @@
+#include "codec_benchmark.hpp"
+#include "byte_codec.hpp"
+#include <SFML/System.hpp>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+const std::size_t BENCH_MAP_SIDE = 2048; // Tiles per side: 16 MiB of int32 tiles
+const int BENCH_ROUNDS = 10;
+
+template <typename Work>
+double gigabytesPerSecond(std::size_t bytesPerRound, Work &&work)
+{
+    work(); // Warm caches and the allocator
+    sf::Clock clock;
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+        work();
+    double seconds = clock.getElapsedTime().asSeconds();
+    return static_cast<double>(bytesPerRound) * BENCH_ROUNDS / seconds / 1e9;
+}
+} // namespace
+
+int runCodecBenchmark()
+{
+    const std::size_t count = BENCH_MAP_SIDE * BENCH_MAP_SIDE;
+    const std::size_t bytes = count * sizeof(int32_t);
+
+    std::vector<int32_t> tiles(count);
+    std::mt19937 random(7);
+    for (auto &tile : tiles)
+        tile = static_cast<int32_t>(random() % 8);
+
+    sf::Packet encoded;
+    writeArray(encoded, tiles.data(), tiles.size());
+
+    std::vector<int32_t> decoded(count);
+    sf::Packet scratch;
+
+    double elementWrite = gigabytesPerSecond(bytes, [&]() {
+        scratch.clear();
+        for (int32_t tile : tiles)
+            scratch << tile;
+    });
+    double bulkWrite = gigabytesPerSecond(bytes, [&]() {
+        scratch.clear();
+        writeArray(scratch, tiles.data(), tiles.size());
+    });
+
+    double elementRead = gigabytesPerSecond(bytes, [&]() {
+        sf::Packet packet = encoded; // Fresh read position each round
+        for (auto &tile : decoded)
+            packet >> tile;
+    });
+    bool elementOk = decoded == tiles;
+
+    std::fill(decoded.begin(), decoded.end(), 0);
+    double bulkRead = gigabytesPerSecond(bytes, [&]() {
+        ByteReader reader(encoded.getData(), encoded.getDataSize());
+        reader.readArray(decoded.data(), decoded.size());
+    });
+    bool bulkOk = decoded == tiles;
+
+    std::cout << "Tile array codec, " << BENCH_MAP_SIDE << "x" << BENCH_MAP_SIDE << " int32 tiles ("
+              << bytes / (1024 * 1024) << " MiB), " << BENCH_ROUNDS << " rounds" << std::endl;
+    std::cout << "  encode per element: " << elementWrite << " GB/s" << std::endl;
+    std::cout << "  encode bulk:        " << bulkWrite << " GB/s" << std::endl;
+    std::cout << "  decode per element: " << elementRead << " GB/s" << std::endl;
+    std::cout << "  decode bulk:        " << bulkRead << " GB/s" << std::endl;
+
+    if (!elementOk || !bulkOk)
+    {
+        std::cerr << "Codec benchmark: decoded tiles differ from the source" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "epoch.hpp"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+// Per-thread slot in epochDomain(), released when the thread exits
+struct EpochThreadSlot
+{
+    static const std::size_t NONE = static_cast<std::size_t>(-1);
+
+    ~EpochThreadSlot()
+    {
+        if (slot != NONE)
+            epochDomain().releaseSlot(slot);
+    }
+
+    std::size_t slot = NONE;
+    int depth = 0;
+};
+
+namespace
+{
+thread_local EpochThreadSlot threadSlot;
+} // namespace
+
+std::size_t EpochDomain::claimSlot()
+{
+    for (;;)
+    {
+        for (std::size_t i = 0; i < MAX_READER_THREADS; ++i)
+        {
+            bool expected = false;
+            if (!slots[i].claimed.load(std::memory_order_relaxed) &&
+                slots[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return i;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void EpochDomain::releaseSlot(std::size_t slot)
+{
+    slots[slot].epoch.store(0, std::memory_order_release);
+    slots[slot].claimed.store(false, std::memory_order_release);
+}
+
+void EpochDomain::enter()
+{
+    if (threadSlot.depth++ > 0)
+        return;
+    if (threadSlot.slot == EpochThreadSlot::NONE)
+        threadSlot.slot = claimSlot();
+    // Sequentially consistent so either collect() sees this pin or the
+    // reader's next load sees the writer's newly published pointer
+    slots[threadSlot.slot].epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+void EpochDomain::leave()
+{
+    if (--threadSlot.depth > 0)
+        return;
+    slots[threadSlot.slot].epoch.store(0, std::memory_order_release);
+}
+
+void EpochDomain::retire(void *object, void (*destroy)(void *))
+{
+    // Readers that pinned before this epoch may hold the object; anyone
+    // pinning later sees the epoch advanced and cannot reach it
+    const uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retired.push_back({epoch, object, destroy});
+}
+
+std::size_t EpochDomain::collect()
+{
+    uint64_t oldestPinned = std::numeric_limits<uint64_t>::max();
+    for (const Slot &slot : slots)
+    {
+        const uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0)
+            oldestPinned = std::min(oldestPinned, epoch);
+    }
+
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        auto firstKept = std::partition(retired.begin(), retired.end(),
+                                        [oldestPinned](const Retired &entry) { return entry.epoch < oldestPinned; });
+        ready.assign(retired.begin(), firstKept);
+        retired.erase(retired.begin(), firstKept);
+    }
+    // Outside the lock: destroying may retire or collect again
+    for (const Retired &entry : ready)
+        entry.destroy(entry.object);
+    return ready.size();
+}
+
+std::size_t EpochDomain::pendingCount()
+{
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return retired.size();
+}
+
+EpochDomain &epochDomain()
+{
+    static EpochDomain domain;
+    return domain;
+}
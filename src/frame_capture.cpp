@@ -0,0 +1,342 @@
+#include "frame_capture.hpp"
+#include <SFML/OpenGL.hpp>
+#include <SFML/Window.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+namespace
+{
+// Buffer and sync entry points past GL 1.1 are not exported by every
+// platform's GL library, so they are fetched through SFML at run time
+const GLenum PIXEL_PACK_BUFFER = 0x88EB;
+const GLenum STREAM_READ = 0x88E1;
+const GLbitfield MAP_READ_BIT = 0x0001;
+const GLenum SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+const GLbitfield SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+const GLenum ALREADY_SIGNALED = 0x911A;
+const GLenum CONDITION_SATISFIED = 0x911C;
+const uint64_t STOP_WAIT_NANOSECONDS = 1000000000; // Per pending read when stopping
+
+struct PixelBufferGl
+{
+    void(APIENTRY *genBuffers)(GLsizei, GLuint *);
+    void(APIENTRY *deleteBuffers)(GLsizei, const GLuint *);
+    void(APIENTRY *bindBuffer)(GLenum, GLuint);
+    void(APIENTRY *bufferData)(GLenum, std::ptrdiff_t, const void *, GLenum);
+    void *(APIENTRY *mapBufferRange)(GLenum, std::ptrdiff_t, std::ptrdiff_t, GLbitfield);
+    GLboolean(APIENTRY *unmapBuffer)(GLenum);
+    void *(APIENTRY *fenceSync)(GLenum, GLbitfield);
+    GLenum(APIENTRY *clientWaitSync)(void *, GLbitfield, uint64_t);
+    void(APIENTRY *deleteSync)(void *);
+};
+
+template <typename Function>
+bool loadFunction(Function &function, const char *name)
+{
+    function = reinterpret_cast<Function>(sf::Context::getFunction(name));
+    return function != nullptr;
+}
+
+// Null when the active context lacks any of them; call with a context active
+const PixelBufferGl *pixelBufferGl()
+{
+    static const PixelBufferGl *loaded = []() -> const PixelBufferGl * {
+        static PixelBufferGl gl;
+        const bool complete = loadFunction(gl.genBuffers, "glGenBuffers") &&
+                              loadFunction(gl.deleteBuffers, "glDeleteBuffers") &&
+                              loadFunction(gl.bindBuffer, "glBindBuffer") &&
+                              loadFunction(gl.bufferData, "glBufferData") &&
+                              loadFunction(gl.mapBufferRange, "glMapBufferRange") &&
+                              loadFunction(gl.unmapBuffer, "glUnmapBuffer") &&
+                              loadFunction(gl.fenceSync, "glFenceSync") &&
+                              loadFunction(gl.clientWaitSync, "glClientWaitSync") &&
+                              loadFunction(gl.deleteSync, "glDeleteSync");
+        return complete ? &gl : nullptr;
+    }();
+    return loaded;
+}
+} // namespace
+
+FrameCapture::FrameCapture()
+    : capturedFrames(metricsRegistry().counter("client_capture_frames_total", "Frames read back for capture.")),
+      droppedFrames(metricsRegistry().counter("client_capture_dropped_frames_total",
+                                              "Frames skipped because every capture buffer was busy.")),
+      writtenFrames(metricsRegistry().counter("client_capture_written_frames_total", "Captured frames written to disk."))
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+bool FrameCapture::start(const std::string &outputDirectory, sf::Vector2u frameSize, std::size_t bufferCount,
+                         unsigned workerCount)
+{
+    if (running)
+        return true;
+
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+    if (error)
+    {
+        std::cerr << "Failed to create capture directory " << outputDirectory << ": " << error.message() << std::endl;
+        return false;
+    }
+    directory = outputDirectory;
+
+    // Allocate and touch everything now so capturing never allocates
+    frames.resize(std::max<std::size_t>(1, bufferCount));
+    freeFrames.clear();
+    pendingFrames.clear();
+    readyFrames.clear();
+    encodedFrames.clear();
+    freeFrames.reserve(frames.size());
+    pendingFrames.reserve(frames.size());
+    readyFrames.reserve(frames.size());
+    encodedFrames.reserve(frames.size());
+    recycling.clear();
+    recycling.reserve(frames.size());
+    for (std::size_t i = 0; i < frames.size(); ++i)
+    {
+        frames[i].pixels.assign(static_cast<std::size_t>(frameSize.x) * frameSize.y * 4, 0);
+        frames[i].size = frameSize;
+        freeFrames.push_back(i);
+    }
+    buffersCreated = false; // Pixel buffers need the window's context; made on the first capture
+
+    stopping = false;
+    running = true;
+    for (unsigned i = 0; i < std::max(1u, workerCount); ++i)
+    {
+        workers.emplace_back(&FrameCapture::workerLoop, this);
+    }
+    std::cout << "Capturing frames to " << directory << std::endl;
+    return true;
+}
+
+void FrameCapture::stop()
+{
+    if (!running)
+        return;
+    collectReads(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameReady.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    recycleEncoded();
+    deleteBuffers();
+    running = false;
+    std::cout << "Frame capture stopped (" << writtenFrames.get() << " written, " << droppedFrames.get()
+              << " dropped)" << std::endl;
+}
+
+void FrameCapture::createBuffers()
+{
+    buffersCreated = true;
+    const PixelBufferGl *gl = pixelBufferGl();
+    if (!gl)
+    {
+        std::cerr << "Pixel buffers or fences unavailable; capture reads back synchronously" << std::endl;
+        return;
+    }
+    for (Frame &frame : frames)
+    {
+        gl->genBuffers(1, &frame.buffer);
+        gl->bindBuffer(PIXEL_PACK_BUFFER, frame.buffer);
+        gl->bufferData(PIXEL_PACK_BUFFER, static_cast<std::ptrdiff_t>(frame.pixels.size()), nullptr, STREAM_READ);
+    }
+    gl->bindBuffer(PIXEL_PACK_BUFFER, 0); // SFML's own reads expect client memory
+}
+
+void FrameCapture::deleteBuffers()
+{
+    const PixelBufferGl *gl = buffersCreated ? pixelBufferGl() : nullptr;
+    for (Frame &frame : frames)
+    {
+        if (gl && frame.buffer != 0)
+            gl->deleteBuffers(1, &frame.buffer);
+        frame.buffer = 0;
+    }
+    buffersCreated = false;
+}
+
+void FrameCapture::capture(sf::RenderWindow &window)
+{
+    if (!running || !window.setActive(true))
+        return;
+    if (!buffersCreated)
+        createBuffers();
+    recycleEncoded();
+    collectReads(false);
+
+    if (freeFrames.empty())
+    {
+        droppedFrames.add();
+        ++nextFrameNumber;
+        return;
+    }
+    const std::size_t index = freeFrames.back();
+    Frame &frame = frames[index];
+    sf::Vector2u windowSize = window.getSize();
+    if (static_cast<std::size_t>(windowSize.x) * windowSize.y * 4 > frame.pixels.size())
+    {
+        // Window grew past the preallocated buffers; dropping beats allocating here
+        droppedFrames.add();
+        ++nextFrameNumber;
+        return;
+    }
+    freeFrames.pop_back();
+    frame.size = windowSize;
+    frame.number = nextFrameNumber++;
+    capturedFrames.add();
+
+    // Read the back buffer before display() swaps it away
+    const GLsizei width = static_cast<GLsizei>(windowSize.x), height = static_cast<GLsizei>(windowSize.y);
+    if (frame.buffer != 0)
+    {
+        // Into the pixel buffer: the call returns at once and the fence says when it has landed
+        const PixelBufferGl *gl = pixelBufferGl();
+        gl->bindBuffer(PIXEL_PACK_BUFFER, frame.buffer);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        frame.fence = gl->fenceSync(SYNC_GPU_COMMANDS_COMPLETE, 0);
+        gl->bindBuffer(PIXEL_PACK_BUFFER, 0);
+        pendingFrames.push_back(index);
+        return;
+    }
+
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame.pixels.data());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readyFrames.push_back(index);
+    }
+    frameReady.notify_one();
+}
+
+void FrameCapture::collectReads(bool wait)
+{
+    const PixelBufferGl *gl = pendingFrames.empty() ? nullptr : pixelBufferGl();
+    std::size_t collected = 0;
+    for (; collected < pendingFrames.size(); ++collected)
+    {
+        Frame &frame = frames[pendingFrames[collected]];
+        const GLenum status = gl->clientWaitSync(frame.fence, wait ? SYNC_FLUSH_COMMANDS_BIT : 0,
+                                                 wait ? STOP_WAIT_NANOSECONDS : 0);
+        if (status != ALREADY_SIGNALED && status != CONDITION_SATISFIED && !wait)
+            break; // Still in flight; later reads were queued after it
+        gl->deleteSync(frame.fence);
+        frame.fence = nullptr;
+
+        gl->bindBuffer(PIXEL_PACK_BUFFER, frame.buffer);
+        frame.mapped = static_cast<const uint8_t *>(
+            gl->mapBufferRange(PIXEL_PACK_BUFFER, 0, static_cast<std::ptrdiff_t>(frame.pixels.size()), MAP_READ_BIT));
+        gl->bindBuffer(PIXEL_PACK_BUFFER, 0);
+        if (!frame.mapped)
+        {
+            std::cerr << "Failed to map captured frame " << frame.number << std::endl;
+            droppedFrames.add();
+            freeFrames.push_back(pendingFrames[collected]);
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readyFrames.push_back(pendingFrames[collected]);
+        }
+        frameReady.notify_one();
+    }
+    pendingFrames.erase(pendingFrames.begin(), pendingFrames.begin() + static_cast<std::ptrdiff_t>(collected));
+}
+
+void FrameCapture::recycleEncoded()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        recycling.swap(encodedFrames); // Both keep their reserved capacity
+    }
+    for (std::size_t index : recycling)
+    {
+        Frame &frame = frames[index];
+        if (frame.mapped)
+        {
+            const PixelBufferGl *gl = pixelBufferGl();
+            gl->bindBuffer(PIXEL_PACK_BUFFER, frame.buffer);
+            gl->unmapBuffer(PIXEL_PACK_BUFFER);
+            gl->bindBuffer(PIXEL_PACK_BUFFER, 0);
+            frame.mapped = nullptr;
+        }
+        freeFrames.push_back(index);
+    }
+    recycling.clear();
+}
+
+void FrameCapture::workerLoop()
+{
+    while (true)
+    {
+        std::size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameReady.wait(lock, [this]() { return stopping || !readyFrames.empty(); });
+            if (readyFrames.empty())
+                return; // Stopping and drained
+            // Oldest first so files appear roughly in order
+            index = readyFrames.front();
+            readyFrames.erase(readyFrames.begin());
+        }
+
+        encode(frames[index]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            encodedFrames.push_back(index); // The render thread unmaps it, since only it has the context
+        }
+    }
+}
+
+void FrameCapture::encode(Frame &frame)
+{
+    if (frame.size.x == 0 || frame.size.y == 0)
+        return;
+
+    // GL rows are bottom-up: flip while copying out of the mapped buffer, or in place after a direct read
+    const std::size_t rowBytes = static_cast<std::size_t>(frame.size.x) * 4;
+    uint8_t *pixels = frame.pixels.data();
+    if (frame.mapped)
+    {
+        for (unsigned y = 0; y < frame.size.y; ++y)
+            std::memcpy(pixels + y * rowBytes, frame.mapped + (frame.size.y - 1 - y) * rowBytes, rowBytes);
+    }
+    else
+    {
+        for (unsigned top = 0, bottom = frame.size.y - 1; top < bottom; ++top, --bottom)
+        {
+            std::swap_ranges(pixels + top * rowBytes, pixels + (top + 1) * rowBytes, pixels + bottom * rowBytes);
+        }
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(frame.number));
+    sf::Image image(frame.size, pixels);
+    if (image.saveToFile(std::filesystem::path(directory) / name))
+    {
+        writtenFrames.add();
+    }
+    else
+    {
+        std::cerr << "Failed to write captured frame " << name << std::endl;
+    }
+}
@@ -0,0 +1,73 @@
+#include "frame_pacer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+const float ESTIMATE_WEIGHT = 0.1f;                  // Share of each new sample in the running estimates
+const float DEVIATION_MARGIN = 2.f;                  // Predict mean + this many mean deviations
+const sf::Time SAFETY_MARGIN = sf::milliseconds(1);  // Slack for the driver and scheduler on top
+const sf::Time SLEEP_SLACK = sf::milliseconds(1);    // sf::sleep can overshoot; spin the rest
+} // namespace
+
+void FramePacer::PhaseEstimate::add(sf::Time sample)
+{
+    const float seconds = sample.asSeconds();
+    const float error = seconds - meanSeconds;
+    meanSeconds += ESTIMATE_WEIGHT * error;
+    deviationSeconds += ESTIMATE_WEIGHT * (std::abs(error) - deviationSeconds);
+}
+
+sf::Time FramePacer::PhaseEstimate::predict() const
+{
+    return sf::seconds(meanSeconds + DEVIATION_MARGIN * deviationSeconds);
+}
+
+FramePacer::FramePacer(sf::Time framePeriod, bool startLate) : period(framePeriod), lateStart(startLate)
+{
+    deadline = period;
+}
+
+void FramePacer::waitForFrameStart()
+{
+    if (lateStart)
+    {
+        // Keep a fixed cadence; a late frame moves on to the next deadline still ahead
+        sf::Time now = clock.getElapsedTime();
+        while (deadline <= now)
+            deadline += period;
+
+        sf::Time budget = simulation.predict() + render.predict() + SAFETY_MARGIN;
+        sf::Time start = deadline - std::min(budget, period);
+        if (start - now > SLEEP_SLACK)
+            sf::sleep(start - now - SLEEP_SLACK);
+        while (clock.getElapsedTime() < start)
+        {
+        }
+    }
+    frameStart = clock.getElapsedTime();
+    inputSampledThisFrame = false;
+}
+
+void FramePacer::markInputSampled()
+{
+    inputSampled = clock.getElapsedTime();
+    inputSampledThisFrame = true;
+}
+
+void FramePacer::markSimulationDone()
+{
+    simulationEnd = clock.getElapsedTime();
+    simulation.add(simulationEnd - frameStart);
+}
+
+void FramePacer::markPresented()
+{
+    const sf::Time presented = clock.getElapsedTime();
+    render.add(presented - simulationEnd);
+    if (inputSampledThisFrame)
+        lastInputToPresent = presented - inputSampled;
+    lastMissed = lateStart && presented > deadline;
+    if (lateStart)
+        deadline += period;
+}
@@ -10,97 +10,357 @@
 #include <algorithm> // For std::max/min
 #include <cmath>     // For std::abs
 #include <cstdint>   // For uint32_t
-
-// --- Animation Constants ---
-const int FRAME_WIDTH = 64;               // Frame width in pixels
-const int FRAME_HEIGHT = 64;              // Frame height in pixels
-const int FRAMES_PER_ROW = 8;             // Number of frames per row in sprite sheet
-const float STATE_CHANGE_COOLDOWN = 0.1f; // Cooldown time between state changes (Optional)
-
-// Animation state definitions
-enum class PlayerAnimState
+#include <cerrno>    // For errno
+#include <cstdlib>   // For std::strtoul, std::strtoull, std::strtod
+#include <limits>    // For std::numeric_limits
+
+#include "animation.hpp"
+#include "bot_swarm.hpp"
+#include "channel_benchmark.hpp"
+#include "client_world.hpp"
+#include "codec_benchmark.hpp"
+#include "frame_capture.hpp"
+#include "frame_pacer.hpp"
+#include "memory_stats.hpp"
+#include "metrics.hpp"
+#include "physics_parity.hpp"
+#include "protocol.hpp"
+#include "render_queue.hpp"
+#include "replay.hpp"
+#include "shard_set.hpp"
+#include "soak_test.hpp"
+#include "tile_benchmark.hpp"
+#include "tile_report.hpp"
+
+// --- Replay Constants ---
+const float REPLAY_KEYFRAME_INTERVAL = 5.f; // Seconds between full-state keyframes in captures
+const float REPLAY_SEEK_STEP = 10.f;        // Seconds skipped by PageUp/PageDown during replay
+
+// --- Capture Constants ---
+const std::size_t CAPTURE_BUFFER_COUNT = 8; // Preallocated frames in flight before dropping
+const unsigned CAPTURE_WORKER_COUNT = 2;    // Background PNG encoders
+
+// --- Frame Constants ---
+const float FRAME_RATE = 60.f;
+
+// --- Metrics ---
+
+// Handles to the metrics updated from the game loop
+struct ClientMetrics
 {
-    Stand, // Stand animation
-    Walk,  // Walk animation
-    Jump,  // Jump and Fall animation
-    Stance // Combat stance (currently unused)
+    MetricHistogram &frameSeconds;
+    MetricCounter &framesTotal;
+    MetricCounter &bytesSent;
+    MetricCounter &packetsSent;
+    MetricCounter &bytesReceived;
+    MetricCounter *packetsReceived[PACKET_TYPE_COUNT + 1]; // Last slot counts unknown types
+    MetricGauge &remotePlayers;
+    MetricGauge &connected;
+    MetricGauge &renderItems;
+    MetricGauge &drawCalls;
+    MetricHistogram &inputToPresentSeconds;
+    MetricGauge &predictedFrameSeconds;
+    MetricCounter &missedPresents;
 };
 
-// Animation data structure (start index, frame count, time per frame)
-struct AnimationData
+ClientMetrics registerClientMetrics(MetricsRegistry &registry)
 {
-    int startFrameIndex; // Starting frame index in the sheet (0-based)
-    int frameCount;      // Total number of frames for this animation
-    float timePerFrame;  // Time per frame in seconds
-};
+    ClientMetrics metrics{
+        registry.histogram("client_frame_seconds", "Wall time between consecutive frames.",
+                           {0.004, 0.008, 0.0125, 0.0167, 0.02, 0.025, 0.0333, 0.05, 0.1, 0.25}),
+        registry.counter("client_frames_total", "Frames presented."),
+        registry.counter("client_network_sent_bytes_total", "Bytes sent to the server, including framing."),
+        registry.counter("client_network_sent_packets_total", "Packets sent to the server."),
+        registry.counter("client_network_received_bytes_total", "Bytes received from the server, including framing."),
+        {},
+        registry.gauge("client_remote_players", "Other players currently tracked."),
+        registry.gauge("client_connected", "1 while connected to the server."),
+        registry.gauge("client_render_items", "Items drawn in the last frame."),
+        registry.gauge("client_draw_calls", "Draw calls issued in the last frame."),
+        registry.histogram("client_input_to_present_seconds", "Time from sampling input to presenting its frame.",
+                           {0.001, 0.002, 0.004, 0.006, 0.008, 0.01, 0.0125, 0.0167, 0.025, 0.05}),
+        registry.gauge("client_predicted_frame_seconds", "Predicted simulation plus render time of the next frame."),
+        registry.counter("client_missed_presents_total", "Frames presented after their deadline when pacing late."),
+    };
+    for (uint8_t i = 0; i <= PACKET_TYPE_COUNT; ++i)
+    {
+        const char *name = i < PACKET_TYPE_COUNT ? packetTypeName(static_cast<PacketType>(i)) : "Unknown";
+        metrics.packetsReceived[i] = &registry.counter("client_network_received_packets_total",
+                                                       "Packets received from the server by type.",
+                                                       std::string("type=\"") + name + "\"");
+    }
+
+    MetricGauge &residentBytes = registry.gauge("process_resident_memory_bytes", "Resident memory size in bytes.");
+    MetricGauge &heapInUse = registry.gauge("process_heap_in_use_bytes", "Heap bytes handed out by the allocator.");
+    MetricGauge &heapFree = registry.gauge("process_heap_free_bytes", "Heap bytes held by the allocator but unused.");
+    registry.addCollector([&residentBytes, &heapInUse, &heapFree]() {
+        residentBytes.set(static_cast<double>(residentMemoryBytes()));
+        HeapStats heap = heapStats();
+        heapInUse.set(static_cast<double>(heap.inUseBytes));
+        heapFree.set(static_cast<double>(heap.freeBytes));
+    });
+    return metrics;
+}
 
-// Player input state structure (Removed up/down as they are not used for rope)
-struct PlayerInputState
+// Applies everything the shards send to the world, keeping metrics and the recording up to date
+class ServerStreamHandler : public ShardSet::Handler
 {
-    bool up = false;   // Removed
-    bool down = false; // Removed
-    bool left = false;
-    bool right = false;
-    bool jump = false; // Using Space for jump
-};
+public:
+    ServerStreamHandler(ClientWorld &world, ClientMetrics &metrics, ReplayWriter &recorder, const sf::Clock &sessionClock)
+        : world(world), metrics(metrics), recorder(recorder), sessionClock(sessionClock)
+    {
+    }
 
-// Packet type enumeration
-enum class PacketType : uint8_t
-{ // Explicit underlying type
-    Welcome,
-    PlayerState,
-    PlayerInput,
-    PlayerJoined,
-    PlayerLeft,
-    MapData
+    void onMessage(uint32_t shardId, PacketType type, sf::Packet &packet) override
+    {
+        metrics.bytesReceived.add(packet.getDataSize() + PACKET_SIZE_PREFIX);
+        metrics.packetsReceived[std::min(static_cast<uint8_t>(type), PACKET_TYPE_COUNT)]->add();
+        recorder.writeMessage(sessionClock.getElapsedTime(), shardId, packet);
+        const uint32_t authorityBefore = world.myShardId;
+        applyPacket(world, type, packet, shardId);
+        // A ShardInfo from our authority renames its connection (see
+        // relabelShard); the rest of a map it is streaming arrives under the
+        // new id. Control messages overtake bulk slices, so this happens mid-map.
+        if (type == PacketType::ShardInfo && streamingShard == shardId && shardId == authorityBefore)
+            streamingShard = world.myShardId;
+    }
+
+    void onMapBegin(uint32_t shardId, uint32_t width, uint32_t height) override
+    {
+        metrics.bytesReceived.add(PACKET_SIZE_PREFIX + 1 + sizeof(width) + sizeof(height));
+        metrics.packetsReceived[static_cast<uint8_t>(PacketType::MapData)]->add();
+        if (shardId != world.myShardId)
+            return; // Only the authoritative shard's map is shown
+        streamingShard = shardId;
+        beginMap(world, width, height);
+    }
+
+    void onMapTiles(uint32_t shardId, std::size_t firstTile, const int32_t *tiles, std::size_t count) override
+    {
+        metrics.bytesReceived.add(count * sizeof(int32_t));
+        if (streamingShard == shardId)
+            applyMapTiles(world, firstTile, tiles, count);
+    }
+
+    void onMapEnd(uint32_t shardId, bool complete) override
+    {
+        if (streamingShard != shardId)
+            return;
+        streamingShard.reset();
+        endMap(world, complete);
+        if (complete && recorder.isOpen())
+        {
+            // The map was never buffered whole; re-encode it for the capture
+            sf::Packet packet;
+            writeMapData(world, packet);
+            recorder.writeMessage(sessionClock.getElapsedTime(), shardId, packet);
+        }
+    }
+
+private:
+    ClientWorld &world;
+    ClientMetrics &metrics;
+    ReplayWriter &recorder;
+    const sf::Clock &sessionClock;
+    std::optional<uint32_t> streamingShard; // Shard whose map is being streamed into the world
 };
 
-// Packet
-sf::Packet &operator<<(sf::Packet &packet, const PlayerInputState &input)
+void printUsage()
 {
-    return packet << input.up << input.down << input.left << input.right << input.jump;
+    std::cerr << "Usage: client [--metrics-port <port>] [--soak <cycles>] [--bench-codec] [--bench-tiles] [--bench-channels] [--bots <count>]"
+              << " [--parity <capture>] [--tile-report <capture>]... [--pacing late|fixed] [--record <file>] [--replay <file> [--seek <seconds>]] [--capture <dir>]" << std::endl;
 }
 
-sf::Packet &operator>>(sf::Packet &packet, PlayerInputState &input)
+// Accepts a whole decimal number in 1..65535; anything else leaves port alone
+bool parsePort(const char *text, unsigned short &port)
 {
-    return packet >> input.up >> input.down >> input.left >> input.right >> input.jump;
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long value = std::strtoul(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || value < 1 || value > 65535)
+        return false;
+    port = static_cast<unsigned short>(value);
+    return true;
 }
 
-sf::Packet &operator<<(sf::Packet &packet, PacketType type)
+// Accepts a whole decimal number in 1..max; strtoull would wrap a leading '-'
+bool parseCount(const char *text, uint64_t max, uint64_t &count)
 {
-    return packet << static_cast<uint8_t>(type);
+    if (*text < '0' || *text > '9')
+        return false;
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || value < 1 || value > max)
+        return false;
+    count = value;
+    return true;
 }
 
-sf::Packet &operator>>(sf::Packet &packet, PacketType &type)
+// Accepts a finite, non-negative number of seconds
+bool parseSeconds(const char *text, float &seconds)
 {
-    uint8_t value;
-    packet >> value;
-    type = static_cast<PacketType>(value);
-    return packet;
+    char *end = nullptr;
+    errno = 0;
+    const double value = std::strtod(text, &end);
+    if (errno != 0 || end == text || *end != '\0' || !std::isfinite(value) || value < 0.0 ||
+        value > std::numeric_limits<float>::max())
+        return false;
+    seconds = static_cast<float>(value);
+    return true;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    // --- Command line ---
+    unsigned short metricsPort = 0; // 0 = metrics endpoint disabled
+    std::optional<SoakOptions> soak;
+    bool benchCodec = false;
+    bool benchTiles = false;
+    bool benchChannels = false;
+    std::optional<BotOptions> bots;
+    std::optional<ParityOptions> parity;
+    std::vector<std::string> tileReportPaths;
+    std::string recordPath;
+    std::string replayPath;
+    float replaySeek = 0.f;
+    std::string captureDirectory = "captures";
+    bool captureAtStart = false;
+    bool lateFrameStart = true; // --pacing late; fixed lets the window's frame limiter sleep after rendering
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--metrics-port" && i + 1 < argc)
+        {
+            if (!parsePort(argv[++i], metricsPort))
+            {
+                std::cerr << "Invalid metrics port: " << argv[i] << " (expected 1-65535)" << std::endl;
+                printUsage();
+                return -1;
+            }
+        }
+        else if (arg == "--soak" && i + 1 < argc)
+        {
+            soak.emplace();
+            if (!parseCount(argv[++i], std::numeric_limits<uint64_t>::max(), soak->cycles))
+            {
+                std::cerr << "Invalid soak cycle count: " << argv[i] << " (expected a positive number)" << std::endl;
+                printUsage();
+                return -1;
+            }
+        }
+        else if (arg == "--bench-codec")
+        {
+            benchCodec = true;
+        }
+        else if (arg == "--bench-tiles")
+        {
+            benchTiles = true;
+        }
+        else if (arg == "--bench-channels")
+        {
+            benchChannels = true;
+        }
+        else if (arg == "--bots" && i + 1 < argc)
+        {
+            bots.emplace();
+            uint64_t count = 0;
+            if (!parseCount(argv[++i], std::numeric_limits<uint32_t>::max(), count))
+            {
+                std::cerr << "Invalid bot count: " << argv[i] << " (expected a positive number)" << std::endl;
+                printUsage();
+                return -1;
+            }
+            bots->count = static_cast<uint32_t>(count);
+        }
+        else if (arg == "--parity" && i + 1 < argc)
+        {
+            parity.emplace();
+            parity->capturePath = argv[++i];
+        }
+        else if (arg == "--tile-report" && i + 1 < argc)
+        {
+            tileReportPaths.push_back(argv[++i]);
+        }
+        else if (arg == "--pacing" && i + 1 < argc && (std::string(argv[i + 1]) == "late" ||
+                                                      std::string(argv[i + 1]) == "fixed"))
+        {
+            lateFrameStart = std::string(argv[++i]) == "late";
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+        else if (arg == "--seek" && i + 1 < argc)
+        {
+            if (!parseSeconds(argv[++i], replaySeek))
+            {
+                std::cerr << "Invalid seek time: " << argv[i] << " (expected seconds, 0 or more)" << std::endl;
+                printUsage();
+                return -1;
+            }
+        }
+        else if (arg == "--capture" && i + 1 < argc)
+        {
+            captureDirectory = argv[++i];
+            captureAtStart = true;
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage();
+            return -1;
+        }
+    }
+
+    if (soak)
+    {
+        return runSoakTest(*soak);
+    }
+    if (benchCodec)
+    {
+        return runCodecBenchmark();
+    }
+    if (benchTiles)
+    {
+        return runTileBenchmark();
+    }
+    if (benchChannels)
+    {
+        return runChannelBenchmark();
+    }
+    if (parity)
+    {
+        return runPhysicsParity(*parity);
+    }
+    if (!tileReportPaths.empty())
+    {
+        return runTileReport(tileReportPaths);
+    }
+
+    ClientMetrics metrics = registerClientMetrics(metricsRegistry());
+    MetricsServer metricsServer;
+    if (metricsPort != 0 && !metricsServer.start(metricsPort))
+    {
+        return -1;
+    }
+    if (bots)
+    {
+        return runBotSwarm(*bots); // Headless; metrics stay available for the run
+    }
+
     // --- ʱȭ ---
     //  
     sf::RenderWindow window(sf::VideoMode({800, 600}), "Client");
-    window.setFramerateLimit(60);
-
-    // Map data variables
-    std::vector<std::vector<int>> clientTileMap;
-    int clientMapWidth = 0;
-    int clientMapHeight = 0;
-    const float CLIENT_TILE_SIZE = 40.f;
-    std::vector<sf::RectangleShape> mapShapes;
-    bool mapLoaded = false;
-
-    // Animation data initialization (Corrected Stand index)
-    std::map<PlayerAnimState, AnimationData> animData = {
-        {PlayerAnimState::Stand, {64, 1, 0.18f}}, // Stand: start at 64, 1 frame
-        {PlayerAnimState::Walk, {32, 8, 0.1f}},   // Walk: start at 32, 8 frames
-        {PlayerAnimState::Jump, {42, 6, 0.1f}},   // Jump and Fall: start at 42, 6 frames
-        {PlayerAnimState::Stance, {0, 4, 0.18f}}  // Stance: start at 0, 4 frames (unused for now)
-    };
+    FramePacer pacer(sf::seconds(1.f / FRAME_RATE), lateFrameStart);
+    if (!pacer.startsLate())
+        window.setFramerateLimit(static_cast<unsigned>(FRAME_RATE));
+
+    const auto &animData = playerAnimations();
 
     // Player variables
     sf::Texture playerTexture;
@@ -110,315 +370,166 @@ int main()
         return -1;
     }
 
-    sf::Sprite playerSprite(playerTexture);
-    playerSprite.setOrigin({FRAME_WIDTH / 2.f, FRAME_HEIGHT / 2.f}); // Bottom-center origin
-    playerSprite.setPosition({400.f, 300.f});                        // Initial position
+    // Map, local player and other players
+    ClientWorld world(playerTexture);
+    sf::Sprite &playerSprite = world.playerSprite;
 
     sf::View gameView;                // Create view
     gameView.setSize({800.f, 600.f}); // Set size
+    RenderQueue renderQueue;
 
     PlayerAnimState currentAnimState = PlayerAnimState::Stand;
-    bool myIsOnGround = true; // Assume starting on ground
-    float previousX = playerSprite.getPosition().x;
     bool facingRight = true;
     int currentFrame = 0;
     sf::Time animTimer = sf::Time::Zero;
     sf::Time stateChangeCooldownTimer = sf::Time::Zero; // Renamed for clarity
 
-    // Other players
-    uint32_t myPlayerId = static_cast<uint32_t>(-1); // Use uint32_t, init to invalid ID
-    std::map<uint32_t, std::shared_ptr<sf::Sprite>> otherPlayers;
-    std::map<uint32_t, PlayerAnimState> otherPlayersAnimState;
-    std::map<uint32_t, int> otherPlayersCurrentFrame;
-    std::map<uint32_t, sf::Time> otherPlayersAnimTimer;
-    std::map<uint32_t, bool> otherPlayersFacingRight;
-
-    sf::TcpSocket socket;
     sf::IpAddress serverIp = sf::IpAddress::LocalHost;
     unsigned short serverPort = 53000;
-    bool connected = false;
+    ShardSet shards(world); // First server plus the neighbouring shards it advertises
+
+    // Capture and playback
+    sf::Clock sessionClock; // Timestamps for recorded messages
+    ReplayWriter recorder;
+    if (!recordPath.empty() && !recorder.open(recordPath, sf::seconds(REPLAY_KEYFRAME_INTERVAL)))
+    {
+        return -1;
+    }
+    ReplayReader replay;
+    const bool replaying = !replayPath.empty();
+    sf::Time replayTime = sf::Time::Zero;
+    if (replaying)
+    {
+        if (!replay.open(replayPath) || !replay.seek(sf::seconds(replaySeek), world))
+        {
+            return -1;
+        }
+        replayTime = replay.position();
+        std::cout << "Replaying " << replayPath << " from " << replayTime.asSeconds() << "s of "
+                  << replay.duration().asSeconds() << "s" << std::endl;
+    }
+    else
+    {
+        shards.connectInitial(serverIp, serverPort);
+    }
+    ServerStreamHandler streamHandler(world, metrics, recorder, sessionClock);
+
+    // Frame capture, toggled with F12
+    FrameCapture frameCapture;
+    if (captureAtStart &&
+        !frameCapture.start(captureDirectory, window.getSize(), CAPTURE_BUFFER_COUNT, CAPTURE_WORKER_COUNT))
+    {
+        return -1;
+    }
 
     // Game loop
     sf::Clock clock;
     while (window.isOpen())
     {
+        pacer.waitForFrameStart();
         sf::Time dt = clock.restart();
+        metrics.frameSeconds.observe(dt.asSeconds());
         animTimer += dt;
         if (stateChangeCooldownTimer > sf::Time::Zero)
         {
             stateChangeCooldownTimer -= dt;
         }
-        // Update timers for other players
-        for (auto it = otherPlayersAnimTimer.begin(); it != otherPlayersAnimTimer.end(); ++it)
-        {
-            it->second += dt;
-        }
 
         while (const std::optional event = window.pollEvent())
         {
             // "close requested" event: we close the window
             if (event->is<sf::Event::Closed>())
+            {
+                frameCapture.stop(); // Captured frames still live in the window's context
                 window.close();
-        }
+            }
 
-        if (!connected)
-        {
-            if (socket.connect(serverIp, serverPort, sf::seconds(1)) == sf::Socket::Status::Done)
+            const auto *keyPressed = event->getIf<sf::Event::KeyPressed>();
+            if (keyPressed && keyPressed->code == sf::Keyboard::Key::F12)
             {
-                std::cout << "Connected to server!" << std::endl;
-                connected = true;
-                socket.setBlocking(false); // Set non-blocking after connection
+                if (frameCapture.isRunning())
+                    frameCapture.stop();
+                else
+                    frameCapture.start(captureDirectory, window.getSize(), CAPTURE_BUFFER_COUNT, CAPTURE_WORKER_COUNT);
             }
-            else
+            if (replaying && keyPressed &&
+                (keyPressed->code == sf::Keyboard::Key::PageDown || keyPressed->code == sf::Keyboard::Key::PageUp))
             {
+                float step = keyPressed->code == sf::Keyboard::Key::PageDown ? REPLAY_SEEK_STEP : -REPLAY_SEEK_STEP;
+                replayTime = std::max(sf::Time::Zero, std::min(replayTime + sf::seconds(step), replay.duration()));
+                replay.seek(replayTime, world);
             }
         }
 
-        PlayerInputState currentInput; // Create fresh input state each frame
-        if (window.hasFocus())
+        if (replaying)
         {
-            currentInput.left = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Left);
-            currentInput.right = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Right);
-            currentInput.up = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up);
-            currentInput.down = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down);
-            currentInput.jump = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Space); // Use Space for jump
-
-            if (currentInput.right)
-                facingRight = true;
-            else if (currentInput.left)
-                facingRight = false;
+            bool wasFinished = replay.finished();
+            replayTime += dt;
+            replay.advance(replayTime, world);
+            if (replay.finished() && !wasFinished)
+                std::cout << "Replay finished." << std::endl;
         }
 
-        if (connected)
-        {
-            sf::Packet inputPacket;
-            inputPacket << PacketType::PlayerInput << currentInput;
-            socket.send(inputPacket); // TCP send doesn't need address/port here
-        }
-        if (connected)
-        {
-            sf::Packet packet;
-            while (socket.receive(packet) == sf::Socket::Status::Done)
-            { // Loop for TCP stream
-                PacketType type;
-                if (!(packet >> type))
-                {
-                    std::cerr << "Failed to read packet type" << std::endl;
-                    continue;
-                }
+        PlayerInputState currentInput; // Create fresh input state each frame
+        auto sampleInput = [&]() {
+            if (window.hasFocus())
+            {
+                currentInput.left = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Left);
+                currentInput.right = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Right);
+                currentInput.up = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up);
+                currentInput.down = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down);
+                currentInput.jump = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Space); // Use Space for jump
+
+                if (currentInput.right)
+                    facingRight = true;
+                else if (currentInput.left)
+                    facingRight = false;
+            }
+            pacer.markInputSampled();
 
-                switch (type)
-                {
-                case PacketType::Welcome:
-                {
-                    uint32_t receivedId; // Use different variable name
-                    if (!(packet >> receivedId))
-                    { /* Error */
-                        continue;
-                    }
-                    myPlayerId = receivedId; // Store the received ID
-                    std::cout << "Welcome! Your player ID is: " << myPlayerId << std::endl;
-                    break;
-                }
-                case PacketType::PlayerState:
-                {
-                    uint32_t id;
-                    float x, y;
-                    bool isOnGround; // Only receive needed flags
-                    if (!(packet >> id >> x >> y >> isOnGround))
-                    {
-                        std::cerr << "Failed to read player state" << std::endl;
-                        continue;
-                    }
-
-                    if (id == myPlayerId)
-                    {
-                        myIsOnGround = isOnGround; // Update ground state
-                        playerSprite.setPosition({x, y});
-                    }
-                    else
-                    {
-                        // ÷̾ ʿ ϴ Ȯ   
-                        if (otherPlayers.find(id) == otherPlayers.end())
-                        {
-                            otherPlayers[id] = std::make_shared<sf::Sprite>(playerTexture);
-                            // Set the origin for other players here, same as the main player
-                            otherPlayers[id]->setOrigin({FRAME_WIDTH / 2.f, FRAME_HEIGHT / 2.f});
-                            otherPlayersAnimState[id] = PlayerAnimState::Stand;
-                            otherPlayersCurrentFrame[id] = 0;
-                            otherPlayersAnimTimer[id] = sf::Time::Zero;
-                            otherPlayersFacingRight[id] = true; // Default direction
-                            std::cout << "Created other player sprite: " << id << std::endl;
-                        }
-
-                        //  X ǥ  ( 񱳿)
-                        float otherPrevX = otherPlayers[id]->getPosition().x;
-
-                        // ġ Ʈ
-                        otherPlayers[id]->setPosition({x, y});
-
-                        // (FacingRight) Ʈ
-                        if (x > otherPrevX)
-                        {
-                            otherPlayersFacingRight[id] = true; //  ̵
-                        }
-                        else if (x < otherPrevX)
-                        {
-                            otherPlayersFacingRight[id] = false; //  ̵
-                        }
-
-                        // 5. ִϸ̼  Ʈ ( )
-                        bool &otherGroundState = myIsOnGround; // FIX: ٸ ÷̾ isOnGround   ʿ!
-                        // : std::map<uint32_t, bool> otherPlayersOnGround;  ʿ
-                        // otherGroundState = otherPlayersOnGround[id];
-                        // otherPlayersOnGround[id] = isOnGround;
-
-                        PlayerAnimState targetOtherState = otherPlayersAnimState[id]; //    ⺻
-                        if (!isOnGround)
-                        { // FIX: ٸ ÷̾ isOnGround  ؾ !
-                            targetOtherState = PlayerAnimState::Jump;
-                        }
-                        else if (std::abs(x - otherPrevX) > 0.1f)
-                        { // ̵   Walk (Ӱ谪  )
-                            targetOtherState = PlayerAnimState::Walk;
-                        }
-                        else
-                        { //  ְ   Stand
-                            targetOtherState = PlayerAnimState::Stand;
-                        }
-
-                        //     
-                        if (otherPlayersAnimState[id] != targetOtherState)
-                        {
-                            otherPlayersCurrentFrame[id] = 0;
-                            otherPlayersAnimTimer[id] = sf::Time::Zero;
-                        }
-                        otherPlayersAnimState[id] = targetOtherState;
-                    }
-                    break;
-                }
-                case PacketType::PlayerJoined:
-                {
-                    uint32_t id;
-                    float x, y;
-                    bool onGround; // Assume server sends initial state too
-                    // FIX: Adjust parsing if server sends less/more data on join
-                    if (!(packet >> id >> x >> y >> onGround))
-                    { /* Error */
-                        continue;
-                    }
-                    if (id != myPlayerId && otherPlayers.find(id) == otherPlayers.end())
-                    { // Add check if already exists
-                        otherPlayers[id] = std::make_shared<sf::Sprite>(playerTexture);
-                        // Set the origin for other players here, same as the main player
-                        otherPlayers[id]->setOrigin({FRAME_WIDTH / 2.f, FRAME_HEIGHT / 2.f});
-                        otherPlayers[id]->setPosition({x, y});
-                        otherPlayersAnimState[id] = onGround ? PlayerAnimState::Stand : PlayerAnimState::Jump; // Set initial state
-                        otherPlayersCurrentFrame[id] = 0;
-                        otherPlayersAnimTimer[id] = sf::Time::Zero;
-                        otherPlayersFacingRight[id] = true;
-                        std::cout << "Player " << id << " joined." << std::endl;
-                    }
-                    break;
-                }
-                case PacketType::PlayerLeft:
+            if (!replaying && shards.isConnected())
+            {
+                sf::Packet inputPacket;
+                inputPacket << PacketType::PlayerInput << currentInput;
+                if (shards.sendToAuthority(inputPacket)) // Goes to whichever shard owns us
                 {
-                    uint32_t id;
-                    if (!(packet >> id))
-                    { /* Error */
-                        continue;
-                    }
-                    if (id != myPlayerId)
-                    {
-                        if (otherPlayers.erase(id) > 0)
-                        { // Remove and check if successful
-                            otherPlayersAnimState.erase(id);
-                            otherPlayersCurrentFrame.erase(id);
-                            otherPlayersAnimTimer.erase(id);
-                            otherPlayersFacingRight.erase(id);
-                            std::cout << "Player " << id << " left." << std::endl;
-                        }
-                    }
-                    break;
+                    metrics.packetsSent.add();
+                    metrics.bytesSent.add(inputPacket.getDataSize() + PACKET_SIZE_PREFIX);
+                    recorder.writeInput(sessionClock.getElapsedTime(), world.myShardId, inputPacket);
                 }
-                case PacketType::MapData:
-                {
+            }
+        };
 
-                    uint32_t width, height;
-                    if (packet >> width >> height)
-                    {
-                        clientMapWidth = static_cast<int>(width);
-                        clientMapHeight = static_cast<int>(height);
-                        clientTileMap.resize(clientMapHeight, std::vector<int>(clientMapWidth));
-                        mapShapes.clear(); //    Ŭ
-                        bool parseOk = true;
-                        for (int y = 0; y < clientMapHeight; ++y)
-                        {
-                            for (int x = 0; x < clientMapWidth; ++x)
-                            {
-                                int tileValue;
-                                if (packet >> tileValue)
-                                {
-                                    clientTileMap[y][x] = tileValue;
-                                    //  Ÿ Shape  ( ׸)
-                                    if (clientTileMap[y][x] == 1)
-                                    {
-                                        sf::RectangleShape tileShape({CLIENT_TILE_SIZE, CLIENT_TILE_SIZE});
-                                        tileShape.setPosition({x * CLIENT_TILE_SIZE, y * CLIENT_TILE_SIZE});
-                                        tileShape.setFillColor(sf::Color::White); //  
-                                        mapShapes.push_back(tileShape);
-                                    }
-                                }
-                                else
-                                {
-                                    parseOk = false;
-                                    break;
-                                }
-                            }
-                            if (!parseOk)
-                                break;
-                        }
-                        if (parseOk)
-                        {
-
-                            mapLoaded = true;
-
-                            std::cout << "Map data loaded (" << clientMapWidth << "x" << clientMapHeight << ")" << std::endl;
-                        }
-                        else
-                        {
-
-                            std::cerr << "Error: Could not parse map data content" << std::endl;
-                        }
-                    }
-                    else
-                    {
-                        std::cerr << "Error: Could not parse map dimensions" << std::endl;
-                    }
-
-                    break;
-
-                } // End MapData case
-                default:
-                    std::cerr << "Unknown packet type: " << static_cast<int>(type) << std::endl;
-                    break;
-                }
-            } // End while receive
+        // Fixed pacing keeps the old order: input at the top of the frame,
+        // before the network, so the comparison has a true baseline
+        if (!pacer.startsLate())
+            sampleInput();
+
+        if (!replaying)
+        {
+            // Connects pending shards and merges every shard's stream into the world
+            shards.poll(streamHandler);
+            recorder.writeKeyframeIfDue(sessionClock.getElapsedTime(), world);
+            metrics.connected.set(shards.isConnected() ? 1 : 0);
 
             // Handle TCP disconnection more explicitly if needed
-            if (!socket.getRemoteAddress())
-            { // FIX: Removed sf::IpAddress::None
+            if (shards.lostAuthority())
+            {
                 std::cerr << "Disconnected from server." << std::endl;
-                connected = false;
+                frameCapture.stop();
                 window.close(); // Or handle reconnection
             }
         }
 
-        float currentX = playerSprite.getPosition().x; // Use sprite position
+        // Late pacing samples as late as possible: after the network, right
+        // before the local update and render that show it
+        if (pacer.startsLate())
+            sampleInput();
+
         PlayerAnimState targetState = currentAnimState;
 
         // Determine target state based on flags and movement
-        if (!myIsOnGround)
+        if (!world.myIsOnGround)
         {
             targetState = PlayerAnimState::Jump;
         }
@@ -439,13 +550,9 @@ int main()
             stateChangeCooldownTimer = sf::seconds(STATE_CHANGE_COOLDOWN);
 
             // Update texture rect immediately on state change
-            const AnimationData &newData = animData[currentAnimState];      // Use current state here
-            int frameOverallIndex = newData.startFrameIndex + currentFrame; // Use currentFrame (0)
-            int frameCol = frameOverallIndex % FRAMES_PER_ROW;
-            int frameRow = frameOverallIndex / FRAMES_PER_ROW;
-            playerSprite.setTextureRect(sf::IntRect({frameCol * FRAME_WIDTH, frameRow * FRAME_HEIGHT}, {FRAME_WIDTH, FRAME_HEIGHT}));
+            const AnimationData &newData = animData.at(currentAnimState); // Use current state here
+            playerSprite.setTextureRect(animationFrameRect(newData, currentFrame)); // Use currentFrame (0)
         }
-        // previousX = currentX; // Move this to end of loop
 
         if (animData.count(currentAnimState))
         { // Check if state exists in map
@@ -454,80 +561,56 @@ int main()
             {
                 animTimer -= sf::seconds(currentData.timePerFrame);
                 currentFrame = (currentFrame + 1) % currentData.frameCount;
-
-                int frameOverallIndex = currentData.startFrameIndex + currentFrame;
-                int frameCol = frameOverallIndex % FRAMES_PER_ROW;
-                int frameRow = frameOverallIndex / FRAMES_PER_ROW;
-                playerSprite.setTextureRect(sf::IntRect({frameCol * FRAME_WIDTH, frameRow * FRAME_HEIGHT}, {FRAME_WIDTH, FRAME_HEIGHT}));
+                playerSprite.setTextureRect(animationFrameRect(currentData, currentFrame));
             }
         }
 
         playerSprite.setScale({facingRight ? 1.f : -1.f, 1.f});
 
-        for (auto &[id, spritePtr] : otherPlayers)
-        {
-            if (!spritePtr)
-                continue;                    // Safety check
-            sf::Sprite &sprite = *spritePtr; // Use reference for convenience
-            if (otherPlayersAnimState.count(id) && animData.count(otherPlayersAnimState.at(id)))
-            { // Check state exists
-                PlayerAnimState otherState = otherPlayersAnimState.at(id);
-                int &otherFrame = otherPlayersCurrentFrame.at(id);   // Use reference
-                sf::Time &otherTimer = otherPlayersAnimTimer.at(id); // Use reference
-                const AnimationData &otherData = animData.at(otherState);
-
-                if (otherTimer >= sf::seconds(otherData.timePerFrame))
-                {
-                    otherTimer -= sf::seconds(otherData.timePerFrame);
-                    otherFrame = (otherFrame + 1) % otherData.frameCount;
-
-                    int frameOverallIndex = otherData.startFrameIndex + otherFrame;
-                    int frameCol = frameOverallIndex % FRAMES_PER_ROW;
-                    int frameRow = frameOverallIndex / FRAMES_PER_ROW;
-                    sprite.setTextureRect(sf::IntRect({frameCol * FRAME_WIDTH, frameRow * FRAME_HEIGHT}, {FRAME_WIDTH, FRAME_HEIGHT}));
-                }
-                if (otherPlayersFacingRight.count(id))
-                {
-                    sprite.setScale({otherPlayersFacingRight.at(id) ? 1.f : -1.f, 1.f});
-                }
-            }
-        }
+        world.otherPlayers.animate(dt);
 
         sf::Vector2f playerPos = playerSprite.getPosition();
         gameView.setCenter(playerPos);
         // (Optional camera clamping)
-        if (mapLoaded)
+        if (world.mapLoaded)
         {
             float viewHalfWidth = gameView.getSize().x / 2.0f;
             float viewHalfHeight = gameView.getSize().y / 2.0f;
-            float mapWidthPixels = clientMapWidth * CLIENT_TILE_SIZE;
-            float mapHeightPixels = clientMapHeight * CLIENT_TILE_SIZE;
+            float mapWidthPixels = world.clientMapWidth * CLIENT_TILE_SIZE;
+            float mapHeightPixels = world.clientMapHeight * CLIENT_TILE_SIZE;
             float clampedX = std::max(viewHalfWidth, std::min(playerPos.x, mapWidthPixels - viewHalfWidth));
             float clampedY = std::max(viewHalfHeight, std::min(playerPos.y, mapHeightPixels - viewHalfHeight));
             gameView.setCenter({clampedX, clampedY});
         }
 
+        pacer.markSimulationDone();
         window.clear(sf::Color::Black);
         window.setView(gameView); // Apply game view
 
-        if (mapLoaded)
+        // Drawn while a streamed map is still arriving, too
+        for (const auto &shape : world.mapShapes)
         {
-            for (const auto &shape : mapShapes)
-            {
-                window.draw(shape);
-            }
+            renderQueue.submit(RenderLayer::Map, shape);
         }
-        for (const auto &[id, spritePtr] : otherPlayers)
+        for (const auto &player : world.otherPlayers)
         {
-            if (spritePtr)
-                window.draw(*spritePtr);
+            renderQueue.submit(RenderLayer::Players, player.sprite, player.sprite.getPosition().y); // Lower in front
         }
-        window.draw(playerSprite);
+        renderQueue.submit(RenderLayer::LocalPlayer, playerSprite);
+        renderQueue.flush(window);
+        const RenderQueue::Stats &renderStats = renderQueue.lastStats();
+        metrics.renderItems.set(static_cast<double>(renderStats.items));
+        metrics.drawCalls.set(static_cast<double>(renderStats.drawCalls));
 
+        frameCapture.capture(window);
         window.display();
-
-        // Update previousX at the very end
-        previousX = playerSprite.getPosition().x;
+        pacer.markPresented();
+        metrics.framesTotal.add();
+        metrics.inputToPresentSeconds.observe(pacer.inputToPresent().asSeconds());
+        metrics.predictedFrameSeconds.set((pacer.predictedSimulation() + pacer.predictedRender()).asSeconds());
+        if (pacer.missedDeadline())
+            metrics.missedPresents.add();
+        metrics.remotePlayers.set(static_cast<double>(world.otherPlayers.size()));
 
     } // End main game loop
 
@@ -0,0 +1,64 @@
+#include "memory_stats.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+std::size_t residentMemoryBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<std::size_t>(counters.WorkingSetSize);
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        return static_cast<std::size_t>(info.resident_size);
+    return 0;
+#elif defined(__linux__)
+    // statm: total program size, then resident pages
+    std::ifstream statm("/proc/self/statm");
+    std::size_t totalPages = 0;
+    std::size_t residentPages = 0;
+    if (!(statm >> totalPages >> residentPages))
+        return 0;
+    return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+HeapStats heapStats()
+{
+    HeapStats stats;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    stats.available = true;
+    stats.inUseBytes = info.uordblks + info.hblkhd;
+    stats.freeBytes = info.fordblks;
+#elif defined(__GLIBC__)
+    // mallinfo() fields are int and wrap past 2 GiB, good enough for trends
+    struct mallinfo info = mallinfo();
+    stats.available = true;
+    stats.inUseBytes = static_cast<unsigned>(info.uordblks) + static_cast<unsigned>(info.hblkhd);
+    stats.freeBytes = static_cast<unsigned>(info.fordblks);
+#elif defined(__APPLE__)
+    malloc_statistics_t info;
+    malloc_zone_statistics(nullptr, &info);
+    stats.available = true;
+    stats.inUseBytes = info.size_in_use;
+    stats.freeBytes = info.size_allocated - info.size_in_use;
+#endif
+    return stats;
+}
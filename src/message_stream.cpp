@@ -0,0 +1,268 @@
+#include "message_stream.hpp"
+#include "byte_codec.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+struct ChannelMetrics
+{
+    MetricCounter &messages;
+    MetricHistogram &assemblySeconds;
+    MetricHistogram &gapSeconds;
+};
+
+ChannelMetrics &channelMetrics(MessageChannel channel)
+{
+    static std::vector<ChannelMetrics> all = [] {
+        std::vector<ChannelMetrics> metrics;
+        MetricsRegistry &registry = metricsRegistry();
+        for (uint8_t i = 0; i < MESSAGE_CHANNEL_COUNT; ++i)
+        {
+            const std::string labels = std::string("channel=\"") + channelName(static_cast<MessageChannel>(i)) + "\"";
+            metrics.push_back({
+                registry.counter("client_channel_messages_total", "Messages delivered by channel.", labels),
+                registry.histogram("client_channel_assembly_seconds",
+                                   "Time from the first byte of a message to its delivery, by channel.",
+                                   {0.001, 0.005, 0.0167, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5}, labels),
+                registry.histogram("client_channel_gap_seconds", "Time between consecutive deliveries, by channel.",
+                                   {0.005, 0.01, 0.0167, 0.02, 0.025, 0.0333, 0.05, 0.1, 0.25, 0.5, 1}, labels),
+            });
+        }
+        return metrics;
+    }();
+    return all[static_cast<uint8_t>(channel)];
+}
+
+sf::Time streamTime()
+{
+    static const sf::Clock clock;
+    return clock.getElapsedTime();
+}
+} // namespace
+
+MessageStream::MessageStream(MessageChannel channel) : nested(true), channel(channel)
+{
+}
+
+void MessageStream::feed(const uint8_t *data, std::size_t size, MessageSink &sink)
+{
+    while (size > 0)
+    {
+        switch (stage)
+        {
+        case Stage::Size:
+        {
+            if (sizeFilled == 0)
+                messageStart = streamTime();
+            std::size_t n = std::min(size, sizeof(sizeBytes) - sizeFilled);
+            std::memcpy(sizeBytes + sizeFilled, data, n);
+            sizeFilled += n;
+            data += n;
+            size -= n;
+            if (sizeFilled == sizeof(sizeBytes))
+            {
+                sizeFilled = 0;
+                networkToHost(&frameSize, sizeBytes, 1, sizeof(frameSize));
+                headFilled = 0;
+                stage = frameSize > 0 ? Stage::Head : Stage::Size; // Empty frames carry nothing
+            }
+            break;
+        }
+        case Stage::Head:
+        {
+            // The type byte decides; only a streamed MapData also needs its dimensions first
+            std::size_t wanted = headFilled > 0 && streamsAsMap() ? MAP_HEAD_SIZE : 1;
+            std::size_t n = std::min(size, wanted - headFilled);
+            std::memcpy(head + headFilled, data, n);
+            headFilled += n;
+            data += n;
+            size -= n;
+            if (headFilled == (streamsAsMap() ? MAP_HEAD_SIZE : 1))
+                finishHead(sink);
+            break;
+        }
+        case Stage::Body:
+        {
+            std::size_t n = std::min<std::size_t>(size, frameSize - body.size());
+            body.insert(body.end(), data, data + n);
+            data += n;
+            size -= n;
+            if (body.size() == frameSize)
+                finishBody(sink);
+            break;
+        }
+        case Stage::MapTiles:
+        {
+            std::size_t n = feedTiles(data, size, sink);
+            data += n;
+            size -= n;
+            break;
+        }
+        case Stage::Skip:
+        {
+            std::size_t n = std::min<std::size_t>(size, skipRemaining);
+            skipRemaining -= static_cast<uint32_t>(n);
+            data += n;
+            size -= n;
+            if (skipRemaining == 0)
+                stage = Stage::Size;
+            break;
+        }
+        }
+    }
+}
+
+bool MessageStream::streamsAsMap() const
+{
+    return static_cast<PacketType>(head[0]) == PacketType::MapData && frameSize >= STREAMED_MESSAGE_THRESHOLD;
+}
+
+void MessageStream::finishHead(MessageSink &sink)
+{
+    if (streamsAsMap())
+    {
+        uint32_t width, height;
+        networkToHost(&width, head + 1, 1, sizeof(width));
+        networkToHost(&height, head + 5, 1, sizeof(height));
+        tileCount = static_cast<uint64_t>(width) * height;
+        if (MAP_HEAD_SIZE + tileCount * sizeof(int32_t) == frameSize)
+        {
+            tilesDelivered = 0;
+            partialFilled = 0;
+            sink.onMapBegin(width, height);
+            stage = Stage::MapTiles;
+            if (tileCount == 0)
+            {
+                sink.onMapEnd(true);
+                delivered(MessageChannel::Bulk);
+                stage = Stage::Size;
+            }
+            return;
+        }
+        // Size disagrees with the dimensions: buffer it and let the normal decoder report it
+    }
+
+    if (frameSize > MAX_BUFFERED_MESSAGE_SIZE)
+    {
+        std::cerr << "Dropped " << packetTypeName(static_cast<PacketType>(head[0])) << " message of " << frameSize
+                  << " bytes (limit " << MAX_BUFFERED_MESSAGE_SIZE << ")" << std::endl;
+        skipRemaining = frameSize - static_cast<uint32_t>(headFilled);
+        stage = Stage::Skip;
+        return;
+    }
+    body.assign(head, head + headFilled);
+    stage = Stage::Body;
+    if (body.size() == frameSize)
+        finishBody(sink);
+}
+
+void MessageStream::finishBody(MessageSink &sink)
+{
+    stage = Stage::Size;
+    if (!nested && body.size() >= 2 && static_cast<PacketType>(body[0]) == PacketType::ChannelData)
+    {
+        feedChannel(body[1], body.data() + 2, body.size() - 2, sink);
+        body.clear();
+        return;
+    }
+
+    sf::Packet packet;
+    packet.append(body.data(), body.size());
+    body.clear();
+
+    PacketType type;
+    if (packet >> type)
+    {
+        sink.onMessage(type, packet);
+        delivered(nested ? channel : channelFor(type));
+    }
+}
+
+void MessageStream::feedChannel(uint8_t channelIndex, const uint8_t *data, std::size_t size, MessageSink &sink)
+{
+    if (channelIndex >= MESSAGE_CHANNEL_COUNT)
+    {
+        std::cerr << "ChannelData for unknown channel " << static_cast<int>(channelIndex) << " dropped" << std::endl;
+        return;
+    }
+    std::unique_ptr<MessageStream> &stream = channelStreams[channelIndex];
+    if (!stream)
+        stream.reset(new MessageStream(static_cast<MessageChannel>(channelIndex)));
+    // Gaps are measured across both paths a channel's messages take (whole
+    // frames and slices), so deliveries are timed in one place
+    stream->outerDeliveries = lastDelivery;
+    stream->feed(data, size, sink);
+}
+
+void MessageStream::delivered(MessageChannel deliveredOn)
+{
+    const sf::Time now = streamTime();
+    ChannelMetrics &metrics = channelMetrics(deliveredOn);
+    metrics.messages.add();
+    metrics.assemblySeconds.observe((now - messageStart).asSeconds());
+    sf::Time &last = (nested ? outerDeliveries : lastDelivery)[static_cast<uint8_t>(deliveredOn)];
+    if (last != sf::Time::Zero)
+        metrics.gapSeconds.observe((now - last).asSeconds());
+    last = now;
+}
+
+std::size_t MessageStream::feedTiles(const uint8_t *data, std::size_t size, MessageSink &sink)
+{
+    std::size_t consumed = 0;
+
+    // Finish a tile split across two reads
+    if (partialFilled > 0)
+    {
+        std::size_t n = std::min(size, sizeof(partialTile) - partialFilled);
+        std::memcpy(partialTile + partialFilled, data, n);
+        partialFilled += n;
+        consumed += n;
+        if (partialFilled < sizeof(partialTile))
+            return consumed;
+        partialFilled = 0;
+        networkToHost(decoded, partialTile, 1, sizeof(int32_t));
+        sink.onMapTiles(static_cast<std::size_t>(tilesDelivered), decoded, 1);
+        ++tilesDelivered;
+    }
+
+    while (tilesDelivered < tileCount && size - consumed >= sizeof(int32_t))
+    {
+        std::size_t n = std::min<std::size_t>({DECODE_BATCH, (size - consumed) / sizeof(int32_t),
+                                               static_cast<std::size_t>(tileCount - tilesDelivered)});
+        networkToHost(decoded, data + consumed, n, sizeof(int32_t));
+        sink.onMapTiles(static_cast<std::size_t>(tilesDelivered), decoded, n);
+        tilesDelivered += n;
+        consumed += n * sizeof(int32_t);
+    }
+
+    if (tilesDelivered == tileCount)
+    {
+        sink.onMapEnd(true);
+        delivered(MessageChannel::Bulk);
+        stage = Stage::Size;
+        return consumed;
+    }
+
+    // Keep the bytes of a tile that is not complete yet
+    std::size_t leftover = size - consumed;
+    std::memcpy(partialTile, data + consumed, leftover);
+    partialFilled = leftover;
+    return size;
+}
+
+void MessageStream::abort(MessageSink &sink)
+{
+    if (stage == Stage::MapTiles)
+        sink.onMapEnd(false);
+    for (std::unique_ptr<MessageStream> &stream : channelStreams)
+    {
+        if (stream)
+            stream->abort(sink);
+    }
+    stage = Stage::Size;
+    sizeFilled = 0;
+    body.clear();
+}
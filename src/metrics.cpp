@@ -0,0 +1,245 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+void MetricGauge::add(double amount)
+{
+    double current = value.load(std::memory_order_relaxed);
+    while (!value.compare_exchange_weak(current, current + amount, std::memory_order_relaxed))
+    {
+    }
+}
+
+MetricHistogram::MetricHistogram(std::vector<double> bucketUpperBounds)
+    : upperBounds(std::move(bucketUpperBounds)),
+      buckets(new std::atomic<uint64_t>[upperBounds.size() + 1])
+{
+    std::sort(upperBounds.begin(), upperBounds.end());
+    for (std::size_t i = 0; i <= upperBounds.size(); ++i)
+    {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::observe(double sample)
+{
+    // Bucket lists are short, a linear scan beats a binary search here
+    std::size_t index = 0;
+    while (index < upperBounds.size() && sample > upperBounds[index])
+    {
+        ++index;
+    }
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    double current = sampleSum.load(std::memory_order_relaxed);
+    while (!sampleSum.compare_exchange_weak(current, current + sample, std::memory_order_relaxed))
+    {
+    }
+}
+
+MetricsRegistry::Family &MetricsRegistry::family(const std::string &name, const std::string &help, Kind kind)
+{
+    for (auto &existing : families)
+    {
+        if (existing.name != name)
+            continue;
+        // One name is one metric type in the exposition format; a second
+        // type would hand back a series of the wrong class
+        if (existing.kind != kind)
+            throw std::logic_error("Metric " + name + " is already registered as another type");
+        return existing;
+    }
+    families.push_back({name, help, kind, {}});
+    return families.back();
+}
+
+MetricCounter &MetricsRegistry::counter(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Family &fam = family(name, help, Kind::Counter);
+    for (const auto &series : fam.series)
+    {
+        if (series.labels == labels)
+            return *static_cast<MetricCounter *>(series.metric);
+    }
+    counters.emplace_back();
+    fam.series.push_back({labels, &counters.back()});
+    return counters.back();
+}
+
+MetricGauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Family &fam = family(name, help, Kind::Gauge);
+    for (const auto &series : fam.series)
+    {
+        if (series.labels == labels)
+            return *static_cast<MetricGauge *>(series.metric);
+    }
+    gauges.emplace_back();
+    fam.series.push_back({labels, &gauges.back()});
+    return gauges.back();
+}
+
+MetricHistogram &MetricsRegistry::histogram(const std::string &name, const std::string &help,
+                                            std::vector<double> bucketUpperBounds, const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Family &fam = family(name, help, Kind::Histogram);
+    for (const auto &series : fam.series)
+    {
+        if (series.labels == labels)
+            return *static_cast<MetricHistogram *>(series.metric);
+    }
+    histograms.push_back(std::make_unique<MetricHistogram>(std::move(bucketUpperBounds)));
+    fam.series.push_back({labels, histograms.back().get()});
+    return *histograms.back();
+}
+
+void MetricsRegistry::addCollector(std::function<void()> collector)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    collectors.push_back(std::move(collector));
+}
+
+std::string MetricsRegistry::renderText()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &collector : collectors)
+    {
+        collector();
+    }
+
+    std::ostringstream out;
+    out.precision(std::numeric_limits<double>::max_digits10);
+    auto withLabels = [](const std::string &labels, const std::string &extra) {
+        if (labels.empty() && extra.empty())
+            return std::string();
+        if (labels.empty() || extra.empty())
+            return "{" + labels + extra + "}";
+        return "{" + labels + "," + extra + "}";
+    };
+
+    for (const auto &fam : families)
+    {
+        const char *typeName = fam.kind == Kind::Counter ? "counter" : fam.kind == Kind::Gauge ? "gauge" : "histogram";
+        out << "# HELP " << fam.name << ' ' << fam.help << '\n';
+        out << "# TYPE " << fam.name << ' ' << typeName << '\n';
+        for (const auto &series : fam.series)
+        {
+            switch (fam.kind)
+            {
+            case Kind::Counter:
+                out << fam.name << withLabels(series.labels, "") << ' '
+                    << static_cast<const MetricCounter *>(series.metric)->get() << '\n';
+                break;
+            case Kind::Gauge:
+                out << fam.name << withLabels(series.labels, "") << ' '
+                    << static_cast<const MetricGauge *>(series.metric)->get() << '\n';
+                break;
+            case Kind::Histogram:
+            {
+                const auto *hist = static_cast<const MetricHistogram *>(series.metric);
+                uint64_t cumulative = 0;
+                for (std::size_t i = 0; i < hist->bounds().size(); ++i)
+                {
+                    cumulative += hist->bucketCount(i);
+                    std::ostringstream le;
+                    le << "le=\"" << hist->bounds()[i] << '"';
+                    out << fam.name << "_bucket" << withLabels(series.labels, le.str()) << ' ' << cumulative << '\n';
+                }
+                cumulative += hist->bucketCount(hist->bounds().size());
+                out << fam.name << "_bucket" << withLabels(series.labels, "le=\"+Inf\"") << ' ' << cumulative << '\n';
+                out << fam.name << "_sum" << withLabels(series.labels, "") << ' ' << hist->sum() << '\n';
+                out << fam.name << "_count" << withLabels(series.labels, "") << ' ' << cumulative << '\n';
+                break;
+            }
+            }
+        }
+    }
+    return out.str();
+}
+
+MetricsRegistry &metricsRegistry()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+// --- MetricsServer ---
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(unsigned short port)
+{
+    // Loopback only: the snapshot is for local scrapers, not the network
+    if (listener.listen(port, sf::IpAddress::LocalHost) != sf::Socket::Status::Done)
+    {
+        std::cerr << "Failed to open metrics endpoint on port " << port << std::endl;
+        return false;
+    }
+    running = true;
+    thread = std::thread(&MetricsServer::run, this);
+    std::cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+    listener.close();
+}
+
+void MetricsServer::run()
+{
+    sf::SocketSelector selector;
+    selector.add(listener);
+    while (running)
+    {
+        // Short wait so stop() is honoured promptly
+        if (!selector.wait(sf::milliseconds(200)))
+            continue;
+
+        sf::TcpSocket client;
+        if (listener.accept(client) == sf::Socket::Status::Done)
+        {
+            serve(client);
+        }
+    }
+}
+
+void MetricsServer::serve(sf::TcpSocket &client)
+{
+    // Drain whatever request line arrived; plain `nc` sends nothing, so don't insist
+    sf::SocketSelector clientSelector;
+    clientSelector.add(client);
+    if (clientSelector.wait(sf::milliseconds(250)))
+    {
+        char request[1024];
+        std::size_t received = 0;
+        client.receive(request, sizeof(request), received);
+    }
+
+    const std::string body = metricsRegistry().renderText();
+    std::string response = "HTTP/1.0 200 OK\r\n";
+    response += "Content-Type: text/plain; version=0.0.4\r\n";
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    // Accepted sockets are blocking, so this either sends everything or fails
+    if (client.send(response.data(), response.size()) != sf::Socket::Status::Done)
+    {
+        std::cerr << "Failed to send metrics snapshot" << std::endl;
+    }
+    client.disconnect();
+}
@@ -0,0 +1,94 @@
+#include "movement.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Keeps a resolved box from touching the tile it was pushed out of
+const float CONTACT_EPSILON = 0.01f;
+
+template <typename Tiles>
+bool boxHitsSolid(const Tiles &tiles, const MovementParams &params, sf::Vector2f position)
+{
+    const float halfWidth = params.bodyWidth / 2.f;
+    const float halfHeight = params.bodyHeight / 2.f;
+    const int left = static_cast<int>(std::floor((position.x - halfWidth) / params.tileSize));
+    const int right = static_cast<int>(std::floor((position.x + halfWidth - CONTACT_EPSILON) / params.tileSize));
+    const int top = static_cast<int>(std::floor((position.y - halfHeight) / params.tileSize));
+    const int bottom = static_cast<int>(std::floor((position.y + halfHeight - CONTACT_EPSILON) / params.tileSize));
+    for (int y = top; y <= bottom; ++y)
+    {
+        for (int x = left; x <= right; ++x)
+        {
+            if (isSolidTile(tiles, x, y))
+                return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+template <typename Tiles>
+bool isSolidTile(const Tiles &tiles, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= tiles.width() || y >= tiles.height())
+        return true;
+    return tiles.at(x, y) == 1;
+}
+
+template <typename Tiles>
+void stepMovement(MovementState &state, const PlayerInputState &input, const MovementParams &params,
+                  const Tiles &tiles)
+{
+    const float dt = params.tickSeconds;
+    const float halfWidth = params.bodyWidth / 2.f;
+    const float halfHeight = params.bodyHeight / 2.f;
+
+    state.velocity.x = (static_cast<float>(input.right) - static_cast<float>(input.left)) * params.runSpeed;
+    if (input.jump && state.onGround)
+        state.velocity.y = -params.jumpSpeed;
+    state.velocity.y = std::min(state.velocity.y + params.gravity * dt, params.maxFallSpeed);
+
+    // Axis-separated: horizontal first, then vertical. A step never moves
+    // further than a tile, so pushing back to the tile edge is enough.
+    state.position.x += state.velocity.x * dt;
+    if (state.velocity.x != 0.f && boxHitsSolid(tiles, params, state.position))
+    {
+        if (state.velocity.x > 0.f)
+        {
+            float edge = std::floor((state.position.x + halfWidth) / params.tileSize) * params.tileSize;
+            state.position.x = edge - halfWidth;
+        }
+        else
+        {
+            float edge = std::floor((state.position.x - halfWidth) / params.tileSize + 1.f) * params.tileSize;
+            state.position.x = edge + halfWidth;
+        }
+        state.velocity.x = 0.f;
+    }
+
+    state.position.y += state.velocity.y * dt;
+    state.onGround = false;
+    if (boxHitsSolid(tiles, params, state.position))
+    {
+        if (state.velocity.y > 0.f)
+        {
+            float edge = std::floor((state.position.y + halfHeight) / params.tileSize) * params.tileSize;
+            state.position.y = edge - halfHeight;
+            state.onGround = true;
+        }
+        else
+        {
+            float edge = std::floor((state.position.y - halfHeight) / params.tileSize + 1.f) * params.tileSize;
+            state.position.y = edge + halfHeight;
+        }
+        state.velocity.y = 0.f;
+    }
+}
+
+template void stepMovement<TileGrid>(MovementState &, const PlayerInputState &, const MovementParams &,
+                                     const TileGrid &);
+template void stepMovement<TileMapVersion>(MovementState &, const PlayerInputState &, const MovementParams &,
+                                           const TileMapVersion &);
+template bool isSolidTile<TileGrid>(const TileGrid &, int, int);
+template bool isSolidTile<TileMapVersion>(const TileMapVersion &, int, int);
@@ -0,0 +1,518 @@
+#include "nav_graph.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+const char NAV_CACHE_MAGIC[4] = {'2', 'D', 'P', 'N'};
+const uint32_t NAV_CACHE_VERSION = 1; // Part of the map hash too
+
+const int HOLD_STEP_TICKS = 4;     // Granularity of the direction hold lengths tried per link
+const int MAX_HOLD_TICKS = 60;
+const int MAX_FLIGHT_TICKS = 240;  // Longer falls are not links
+const std::size_t MIN_ITEMS_PER_WORKER = 256;
+
+// Splits [0, count) into one contiguous range per worker, in order
+void parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t, std::size_t)> &work)
+{
+    std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    workers = std::max<std::size_t>(1, std::min(workers, count / MIN_ITEMS_PER_WORKER));
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (std::size_t worker = 0; worker < workers; ++worker)
+    {
+        std::size_t begin = count * worker / workers;
+        std::size_t end = count * (worker + 1) / workers;
+        threads.emplace_back(work, begin, end, worker);
+    }
+    for (auto &thread : threads)
+        thread.join();
+}
+
+struct Link
+{
+    NavEdge edge;
+    bool found = false;
+};
+
+template <typename T>
+void writeRaw(std::ofstream &out, const std::vector<T> &values)
+{
+    out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+bool readRaw(std::ifstream &in, std::vector<T> &values, std::size_t count)
+{
+    values.resize(count);
+    in.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    return static_cast<bool>(in);
+}
+} // namespace
+
+// --- Building ---
+
+template <typename Tiles>
+void NavGraph::build(const Tiles &tiles, const MovementParams &movementParams)
+{
+    params = movementParams;
+    width = tiles.width();
+    height = tiles.height();
+    const int bodyTiles = std::max(1, static_cast<int>(std::ceil(params.bodyHeight / params.tileSize)));
+
+    // Standable tiles: room for the body, solid floor below. Rows are independent.
+    nodeIndex.assign(static_cast<std::size_t>(width) * height, -1);
+    parallelFor(static_cast<std::size_t>(height), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const int ty = static_cast<int>(y);
+                bool standable = isSolidTile(tiles, x, ty + 1);
+                for (int k = 0; standable && k < bodyTiles; ++k)
+                    standable = !isSolidTile(tiles, x, ty - k);
+                if (standable)
+                    nodeIndex[y * width + x] = 0;
+            }
+        }
+    });
+
+    nodes.clear();
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int32_t &index = nodeIndex[static_cast<std::size_t>(y) * width + x];
+            if (index == 0)
+            {
+                index = static_cast<int32_t>(nodes.size());
+                nodes.push_back({x, y});
+            }
+        }
+    }
+
+    // Links per node, each worker over a contiguous node range so their
+    // results concatenate in node order
+    std::vector<uint32_t> linkCounts(nodes.size());
+    std::vector<std::vector<NavEdge>> workerEdges(std::max(1u, std::thread::hardware_concurrency()));
+    parallelFor(nodes.size(), [&](std::size_t begin, std::size_t end, std::size_t worker) {
+        std::vector<NavEdge> &out = workerEdges[worker];
+        std::vector<Link> links(nodes.size()); // Cheapest link per target of the current node
+        std::vector<uint32_t> targets;
+        for (std::size_t n = begin; n < end; ++n)
+        {
+            const NavNode &from = nodes[n];
+            targets.clear();
+            auto offer = [&](const NavEdge &edge) {
+                Link &link = links[edge.target];
+                if (!link.found)
+                {
+                    link.found = true;
+                    link.edge = edge;
+                    targets.push_back(edge.target);
+                }
+                else if (edge.cost < link.edge.cost)
+                {
+                    link.edge = edge;
+                }
+            };
+
+            for (int8_t direction : {int8_t(-1), int8_t(1)})
+            {
+                int32_t neighbour = nodeIndexAt(from.x + direction, from.y);
+                if (neighbour >= 0)
+                    offer({static_cast<uint32_t>(neighbour), NavEdgeKind::Walk, direction, 0,
+                           params.tileSize / params.runSpeed});
+
+                // Falls and jumps: replay the input a bot would send and see where it lands
+                for (bool jump : {false, true})
+                {
+                    if (!jump && (neighbour >= 0 || isSolidTile(tiles, from.x + direction, from.y)))
+                        continue; // Nothing to fall off on this side
+                    for (int hold = HOLD_STEP_TICKS; hold <= MAX_HOLD_TICKS; hold += HOLD_STEP_TICKS)
+                    {
+                        MovementState state;
+                        state.position = nodePosition(static_cast<uint32_t>(n));
+                        state.onGround = true;
+                        bool airborne = false;
+                        int tick = 0;
+                        for (; tick < MAX_FLIGHT_TICKS; ++tick)
+                        {
+                            PlayerInputState input;
+                            input.left = direction < 0 && tick < hold;
+                            input.right = direction > 0 && tick < hold;
+                            input.jump = jump && tick == 0;
+                            stepMovement(state, input, params, tiles);
+                            if (!state.onGround)
+                                airborne = true;
+                            else if (airborne || tick >= hold)
+                                break;
+                        }
+                        if (!airborne || tick == MAX_FLIGHT_TICKS)
+                            continue;
+
+                        int32_t target = nodeAt(state.position);
+                        if (target >= 0 && target != static_cast<int32_t>(n) && target != neighbour)
+                        {
+                            // Flight time plus the walk to the middle of the landing tile
+                            sf::Vector2f landing = nodePosition(static_cast<uint32_t>(target));
+                            float cost = static_cast<float>(tick + 1) * params.tickSeconds +
+                                         std::abs(landing.x - state.position.x) / params.runSpeed;
+                            offer({static_cast<uint32_t>(target), jump ? NavEdgeKind::Jump : NavEdgeKind::Fall,
+                                   direction, static_cast<uint16_t>(hold), cost});
+                        }
+                        if (tick < hold)
+                            break; // Landed while still holding; longer holds end the same way
+                    }
+                }
+            }
+
+            std::sort(targets.begin(), targets.end());
+            for (uint32_t target : targets)
+            {
+                out.push_back(links[target].edge);
+                links[target].found = false;
+            }
+            linkCounts[n] = static_cast<uint32_t>(targets.size());
+        }
+    });
+
+    edgeOffsets.assign(nodes.size() + 1, 0);
+    for (std::size_t n = 0; n < nodes.size(); ++n)
+        edgeOffsets[n + 1] = edgeOffsets[n] + linkCounts[n];
+    edges.clear();
+    edges.reserve(edgeOffsets.back());
+    for (const auto &part : workerEdges)
+        edges.insert(edges.end(), part.begin(), part.end());
+    labelComponents();
+}
+
+void NavGraph::labelComponents()
+{
+    // Kosaraju with explicit stacks: finishing order on the graph, then
+    // flood fills on the reversed graph in reverse finishing order
+    const uint32_t count = static_cast<uint32_t>(nodes.size());
+    const uint32_t unlabelled = static_cast<uint32_t>(-1);
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    std::vector<uint8_t> seen(count, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> stack; // Node, next edge to follow
+    for (uint32_t root = 0; root < count; ++root)
+    {
+        if (seen[root])
+            continue;
+        seen[root] = 1;
+        stack.push_back({root, edgeOffsets[root]});
+        while (!stack.empty())
+        {
+            auto &[node, next] = stack.back();
+            if (next == edgeOffsets[node + 1])
+            {
+                order.push_back(node);
+                stack.pop_back();
+                continue;
+            }
+            const uint32_t target = edges[next++].target;
+            if (!seen[target])
+            {
+                seen[target] = 1;
+                stack.push_back({target, edgeOffsets[target]});
+            }
+        }
+    }
+
+    std::vector<uint32_t> reverseOffsets(count + 1, 0);
+    for (const NavEdge &edge : edges)
+        ++reverseOffsets[edge.target + 1];
+    for (uint32_t n = 0; n < count; ++n)
+        reverseOffsets[n + 1] += reverseOffsets[n];
+    std::vector<uint32_t> reverseSources(edges.size());
+    std::vector<uint32_t> fill(reverseOffsets.begin(), reverseOffsets.end() - 1);
+    for (uint32_t n = 0; n < count; ++n)
+    {
+        for (uint32_t e = edgeOffsets[n]; e < edgeOffsets[n + 1]; ++e)
+            reverseSources[fill[edges[e].target]++] = n;
+    }
+
+    components.assign(count, unlabelled);
+    uint32_t label = 0;
+    std::vector<uint32_t> pending;
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        if (components[*it] != unlabelled)
+            continue;
+        components[*it] = label;
+        pending.push_back(*it);
+        while (!pending.empty())
+        {
+            const uint32_t node = pending.back();
+            pending.pop_back();
+            for (uint32_t r = reverseOffsets[node]; r < reverseOffsets[node + 1]; ++r)
+            {
+                const uint32_t source = reverseSources[r];
+                if (components[source] == unlabelled)
+                {
+                    components[source] = label;
+                    pending.push_back(source);
+                }
+            }
+        }
+        ++label;
+    }
+}
+
+template <typename Tiles>
+void NavGraph::loadOrBuild(const Tiles &tiles, const MovementParams &movementParams, const std::string &cacheDirectory)
+{
+    const uint64_t hash = mapHash(tiles, movementParams);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.nav", static_cast<unsigned long long>(hash));
+    const std::string path = (std::filesystem::path(cacheDirectory) / name).string();
+
+    sf::Clock timer;
+    if (load(path, hash))
+    {
+        std::cout << "Navigation graph loaded from " << path << " (" << nodes.size() << " nodes, " << edges.size()
+                  << " links) in " << timer.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+        return;
+    }
+
+    build(tiles, movementParams);
+    std::cout << "Navigation graph built (" << nodes.size() << " nodes, " << edges.size() << " links) in "
+              << timer.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+    if (!save(path, hash))
+        std::cerr << "Could not write navigation cache " << path << std::endl;
+}
+
+template <typename Tiles>
+uint64_t NavGraph::mapHash(const Tiles &tiles, const MovementParams &params)
+{
+    // FNV-1a over the format version, movement constants and tiles
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void *data, std::size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(&NAV_CACHE_VERSION, sizeof(NAV_CACHE_VERSION));
+    const float constants[] = {params.tileSize,     params.runSpeed,  params.jumpSpeed,  params.gravity,
+                               params.maxFallSpeed, params.bodyWidth, params.bodyHeight, params.tickSeconds};
+    mix(constants, sizeof(constants));
+    const uint64_t rows = static_cast<uint64_t>(tiles.height());
+    const uint64_t columns = static_cast<uint64_t>(tiles.width());
+    mix(&rows, sizeof(rows));
+    std::vector<int32_t> row(tiles.width());
+    for (int y = 0; y < tiles.height(); ++y)
+    {
+        tiles.unpackRow(y, row.data());
+        mix(&columns, sizeof(columns));
+        mix(row.data(), row.size() * sizeof(int32_t));
+    }
+    return hash;
+}
+
+template void NavGraph::build<TileGrid>(const TileGrid &, const MovementParams &);
+template void NavGraph::build<TileMapVersion>(const TileMapVersion &, const MovementParams &);
+template void NavGraph::loadOrBuild<TileGrid>(const TileGrid &, const MovementParams &, const std::string &);
+template void NavGraph::loadOrBuild<TileMapVersion>(const TileMapVersion &, const MovementParams &,
+                                                    const std::string &);
+template uint64_t NavGraph::mapHash<TileGrid>(const TileGrid &, const MovementParams &);
+template uint64_t NavGraph::mapHash<TileMapVersion>(const TileMapVersion &, const MovementParams &);
+
+// --- Cache ---
+// Raw arrays in host byte order: the cache never leaves the machine that built it.
+
+bool NavGraph::save(const std::string &path, uint64_t hash) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    const uint32_t nodeCount = static_cast<uint32_t>(nodes.size());
+    const uint32_t edgeCount = static_cast<uint32_t>(edges.size());
+    out.write(NAV_CACHE_MAGIC, sizeof(NAV_CACHE_MAGIC));
+    out.write(reinterpret_cast<const char *>(&NAV_CACHE_VERSION), sizeof(NAV_CACHE_VERSION));
+    out.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+    out.write(reinterpret_cast<const char *>(&width), sizeof(width));
+    out.write(reinterpret_cast<const char *>(&height), sizeof(height));
+    out.write(reinterpret_cast<const char *>(&nodeCount), sizeof(nodeCount));
+    out.write(reinterpret_cast<const char *>(&edgeCount), sizeof(edgeCount));
+    writeRaw(out, nodes);
+    writeRaw(out, edgeOffsets);
+    writeRaw(out, edges);
+    return static_cast<bool>(out);
+}
+
+bool NavGraph::load(const std::string &path, uint64_t hash)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+
+    char magic[4];
+    uint32_t version = 0, nodeCount = 0, edgeCount = 0;
+    uint64_t storedHash = 0;
+    int storedWidth = 0, storedHeight = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in.read(reinterpret_cast<char *>(&storedHash), sizeof(storedHash));
+    in.read(reinterpret_cast<char *>(&storedWidth), sizeof(storedWidth));
+    in.read(reinterpret_cast<char *>(&storedHeight), sizeof(storedHeight));
+    in.read(reinterpret_cast<char *>(&nodeCount), sizeof(nodeCount));
+    in.read(reinterpret_cast<char *>(&edgeCount), sizeof(edgeCount));
+    if (!in || std::memcmp(magic, NAV_CACHE_MAGIC, sizeof(magic)) != 0 || version != NAV_CACHE_VERSION ||
+        storedHash != hash || storedWidth < 0 || storedHeight < 0 ||
+        nodeCount > static_cast<uint64_t>(storedWidth) * storedHeight)
+        return false;
+
+    std::vector<NavNode> loadedNodes;
+    std::vector<uint32_t> loadedOffsets;
+    std::vector<NavEdge> loadedEdges;
+    if (!readRaw(in, loadedNodes, nodeCount) || !readRaw(in, loadedOffsets, nodeCount + 1) ||
+        !readRaw(in, loadedEdges, edgeCount))
+        return false;
+
+    // A damaged file must not send lookups out of range
+    if (loadedOffsets.front() != 0 || loadedOffsets.back() != edgeCount ||
+        !std::is_sorted(loadedOffsets.begin(), loadedOffsets.end()))
+        return false;
+    for (const NavEdge &edge : loadedEdges)
+    {
+        if (edge.target >= nodeCount)
+            return false;
+    }
+    std::vector<int32_t> loadedIndex(static_cast<std::size_t>(storedWidth) * storedHeight, -1);
+    for (uint32_t n = 0; n < nodeCount; ++n)
+    {
+        const NavNode &node = loadedNodes[n];
+        if (node.x < 0 || node.x >= storedWidth || node.y < 0 || node.y >= storedHeight)
+            return false;
+        loadedIndex[static_cast<std::size_t>(node.y) * storedWidth + node.x] = static_cast<int32_t>(n);
+    }
+
+    width = storedWidth;
+    height = storedHeight;
+    nodes = std::move(loadedNodes);
+    nodeIndex = std::move(loadedIndex);
+    edgeOffsets = std::move(loadedOffsets);
+    edges = std::move(loadedEdges);
+    labelComponents();
+    return true;
+}
+
+// --- Lookups ---
+
+int32_t NavGraph::nodeIndexAt(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return -1;
+    return nodeIndex[static_cast<std::size_t>(y) * width + x];
+}
+
+int32_t NavGraph::nodeAt(sf::Vector2f position) const
+{
+    // The tile holding the bottom of the body
+    const float feet = position.y + params.bodyHeight / 2.f - 0.5f;
+    return nodeIndexAt(static_cast<int>(std::floor(position.x / params.tileSize)),
+                       static_cast<int>(std::floor(feet / params.tileSize)));
+}
+
+sf::Vector2f NavGraph::nodePosition(uint32_t index) const
+{
+    const NavNode &node = nodes[index];
+    return {(static_cast<float>(node.x) + 0.5f) * params.tileSize,
+            static_cast<float>(node.y + 1) * params.tileSize - params.bodyHeight / 2.f};
+}
+
+const NavEdge *NavGraph::findEdge(uint32_t from, uint32_t to) const
+{
+    for (const NavEdge *edge = edgesBegin(from); edge != edgesEnd(from); ++edge)
+    {
+        if (edge->target == to)
+            return edge;
+    }
+    return nullptr;
+}
+
+// --- Pathfinding ---
+
+NavQuery::NavQuery(const NavGraph &navGraph)
+    : graph(navGraph), costSoFar(navGraph.nodeCount()), cameFrom(navGraph.nodeCount()),
+      visitedStamp(navGraph.nodeCount()), closedStamp(navGraph.nodeCount())
+{
+}
+
+float NavQuery::heuristic(uint32_t from, uint32_t goal) const
+{
+    // Nothing crosses tiles sideways faster than running, so this never overestimates
+    const MovementParams &params = graph.movement();
+    return static_cast<float>(std::abs(graph.node(from).x - graph.node(goal).x)) * params.tileSize / params.runSpeed;
+}
+
+bool NavQuery::findPath(uint32_t start, uint32_t goal, std::vector<uint32_t> &path)
+{
+    path.clear();
+    expanded = 0;
+    if (start >= graph.nodeCount() || goal >= graph.nodeCount())
+        return false;
+
+    if (++stamp == 0)
+    {
+        std::fill(visitedStamp.begin(), visitedStamp.end(), 0);
+        std::fill(closedStamp.begin(), closedStamp.end(), 0);
+        stamp = 1;
+    }
+
+    open.clear();
+    costSoFar[start] = 0.f;
+    cameFrom[start] = start;
+    visitedStamp[start] = stamp;
+    open.push_back({heuristic(start, goal), start});
+
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), std::greater<>());
+        const uint32_t current = open.back().node;
+        open.pop_back();
+        if (closedStamp[current] == stamp)
+            continue; // Stale entry; a cheaper one was already expanded
+        closedStamp[current] = stamp;
+        ++expanded;
+
+        if (current == goal)
+        {
+            for (uint32_t node = goal; node != start; node = cameFrom[node])
+                path.push_back(node);
+            path.push_back(start);
+            std::reverse(path.begin(), path.end());
+            return true;
+        }
+
+        for (const NavEdge *edge = graph.edgesBegin(current); edge != graph.edgesEnd(current); ++edge)
+        {
+            const uint32_t next = edge->target;
+            const float cost = costSoFar[current] + edge->cost;
+            if (visitedStamp[next] == stamp && cost >= costSoFar[next])
+                continue;
+            visitedStamp[next] = stamp;
+            costSoFar[next] = cost;
+            cameFrom[next] = current;
+            open.push_back({cost + heuristic(next, goal), next});
+            std::push_heap(open.begin(), open.end(), std::greater<>());
+        }
+    }
+    return false;
+}
@@ -0,0 +1,223 @@
+#include "physics_parity.hpp"
+#include "client_world.hpp"
+#include "movement.hpp"
+#include "replay.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+// Captures carry no server tick numbers, so the arrival order of the local
+// player's authoritative states is the tick clock: the server sends its owner
+// one PlayerState per tick. Inputs are placed on that clock by how many
+// states had arrived when they were sent.
+struct AuthoritativeState
+{
+    sf::Vector2f position;
+    bool onGround;
+};
+
+struct TickedInput
+{
+    std::size_t tick;
+    PlayerInputState input;
+};
+
+struct ParityTrace
+{
+    std::vector<AuthoritativeState> states;
+    std::vector<TickedInput> inputs;
+    sf::Time firstStateTime;
+    sf::Time lastStateTime;
+    std::size_t foreignStates = 0; // Local player states from shards without authority over us
+};
+
+// Feeds the capture through the real handlers, which track our id, authority
+// shard and map as it unfolds. Loading stops at a map change, so world is
+// left on the map the states were recorded on.
+bool loadTrace(const std::string &path, ClientWorld &world, ParityTrace &trace)
+{
+    ReplayReader reader;
+    if (!reader.open(path))
+        return false;
+
+    bool restored = false;
+    ReplayRecord record;
+    reader.rewind();
+    while (reader.readRecord(record))
+    {
+        if (record.kind == ReplayRecordKind::Keyframe)
+        {
+            if (!restored)
+                readSnapshot(world, record.packet, reader.snapshotFormat()); // Later keyframes repeat what the messages already built
+            restored = true;
+            continue;
+        }
+
+        PacketType type;
+        if (!(record.packet >> type))
+            continue;
+
+        if (record.kind == ReplayRecordKind::Input)
+        {
+            PlayerInputState input;
+            if (type == PacketType::PlayerInput && record.packet >> input)
+                trace.inputs.push_back({trace.states.size(), input});
+            continue;
+        }
+
+        if (isMapMessage(type) && !trace.states.empty())
+        {
+            std::cout << "Map changed at " << record.time.asSeconds() << " s; checking up to there" << std::endl;
+            break;
+        }
+        if (type == PacketType::PlayerState)
+        {
+            sf::Packet state = record.packet; // Copy keeps the read position
+            uint32_t id;
+            float x, y;
+            bool onGround;
+            if (state >> id >> x >> y >> onGround && id == world.myPlayerId && record.shardId != world.myShardId)
+            {
+                ++trace.foreignStates; // Neighbours mirror us near borders
+            }
+            else if (state && id == world.myPlayerId && world.mapLoaded)
+            {
+                if (trace.states.empty())
+                    trace.firstStateTime = record.time;
+                trace.states.push_back({{x, y}, onGround});
+                trace.lastStateTime = record.time;
+            }
+        }
+        applyPacket(world, type, record.packet, record.shardId);
+    }
+    return true;
+}
+
+// Steps the simulation once per authoritative state and records the error
+// before each comparison. A divergent step resyncs to the server's state, so
+// one mistake is counted once instead of for the rest of the capture.
+std::size_t simulate(const ParityTrace &trace, const TileMapVersion &tiles, const MovementParams &params,
+                     std::size_t inputDelay, float tolerance, std::vector<float> &errors)
+{
+    const auto &states = trace.states;
+    errors.clear();
+
+    MovementState state;
+    state.position = states[0].position;
+    state.onGround = states[0].onGround;
+    PlayerInputState input;
+    std::size_t nextInput = 0;
+    std::size_t resyncs = 0;
+    for (std::size_t tick = 1; tick < states.size(); ++tick)
+    {
+        while (nextInput < trace.inputs.size() && trace.inputs[nextInput].tick + inputDelay < tick)
+            input = trace.inputs[nextInput++].input;
+
+        stepMovement(state, input, params, tiles);
+
+        const sf::Vector2f delta = state.position - states[tick].position;
+        const float error = std::sqrt(delta.x * delta.x + delta.y * delta.y);
+        errors.push_back(error);
+        if (error > tolerance)
+        {
+            state.position = states[tick].position;
+            state.velocity = (states[tick].position - states[tick - 1].position) / params.tickSeconds;
+            state.onGround = states[tick].onGround;
+            if (state.onGround)
+                state.velocity.y = 0.f;
+            ++resyncs;
+        }
+    }
+    return resyncs;
+}
+
+float percentile(const std::vector<float> &sorted, double fraction)
+{
+    return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5))];
+}
+} // namespace
+
+int runPhysicsParity(const ParityOptions &options)
+{
+    sf::Texture texture;
+    ClientWorld world(texture);
+    world.logEvents = false;
+    ParityTrace trace;
+    if (!loadTrace(options.capturePath, world, trace))
+        return 1;
+    if (trace.states.size() < 2)
+    {
+        std::cerr << "Capture has no authoritative states for the local player: " << options.capturePath << std::endl;
+        if (trace.foreignStates > 0)
+            std::cerr << "  " << trace.foreignStates << " came from shards without authority over it" << std::endl;
+        return 1;
+    }
+    if (trace.inputs.empty())
+        std::cerr << "Capture has no input records (recorded before format version 3?)" << std::endl;
+
+    const MovementParams params;
+    const double span = (trace.lastStateTime - trace.firstStateTime).asSeconds();
+    const double stateRate = span > 0.0 ? static_cast<double>(trace.states.size() - 1) / span : 0.0;
+    if (std::abs(stateRate * params.tickSeconds - 1.0) > 0.1)
+        std::cerr << "Warning: " << stateRate << " states/s does not match the " << 1.f / params.tickSeconds
+                  << " Hz tick; ticks are counted by states, so results will be off" << std::endl;
+
+    // The delay between sending input and seeing its effect is unknown; try
+    // each and keep the one the server agrees with most
+    TileReadGuard guard(world.clientTileMap);
+    std::vector<float> errors;
+    errors.reserve(trace.states.size());
+    std::size_t bestDelay = 0;
+    std::size_t bestDivergent = static_cast<std::size_t>(-1);
+    double bestMean = 0.0;
+    uint64_t ticksSimulated = 0;
+    sf::Clock clock;
+    for (int delay = 0; delay <= options.maxInputDelayTicks; ++delay)
+    {
+        simulate(trace, guard.tiles(), params, static_cast<std::size_t>(delay), options.tolerancePixels, errors);
+        ticksSimulated += errors.size();
+
+        std::size_t divergent = 0;
+        double sum = 0.0;
+        for (float error : errors)
+        {
+            divergent += error > options.tolerancePixels ? 1 : 0;
+            sum += error;
+        }
+        const double mean = sum / static_cast<double>(errors.size());
+        if (divergent < bestDivergent || (divergent == bestDivergent && mean < bestMean))
+        {
+            bestDelay = static_cast<std::size_t>(delay);
+            bestDivergent = divergent;
+            bestMean = mean;
+        }
+    }
+    const double seconds = clock.getElapsedTime().asSeconds();
+
+    const std::size_t resyncs = simulate(trace, guard.tiles(), params, bestDelay, options.tolerancePixels, errors);
+    std::vector<float> sorted = errors;
+    std::sort(sorted.begin(), sorted.end());
+    const double divergentFraction = static_cast<double>(bestDivergent) / static_cast<double>(errors.size());
+
+    std::cout << "Physics parity: " << options.capturePath << std::endl;
+    std::cout << "  states " << trace.states.size() << " (" << stateRate << "/s), inputs " << trace.inputs.size()
+              << ", input delay " << bestDelay << " ticks" << std::endl;
+    std::cout << "  error px: mean " << bestMean << ", p50 " << percentile(sorted, 0.5) << ", p95 "
+              << percentile(sorted, 0.95) << ", p99 " << percentile(sorted, 0.99) << ", max " << sorted.back()
+              << std::endl;
+    std::cout << "  over " << options.tolerancePixels << " px: " << divergentFraction * 100.0 << "% of ticks ("
+              << resyncs << " resyncs)" << std::endl;
+    std::cout << "  simulation: " << (seconds > 0.0 ? static_cast<double>(ticksSimulated) / seconds / 1e6 : 0.0)
+              << " M ticks/s" << std::endl;
+
+    if (divergentFraction > options.maxDivergentFraction)
+    {
+        std::cout << "FAIL: client simulation diverges from the server" << std::endl;
+        return 1;
+    }
+    std::cout << "PASS" << std::endl;
+    return 0;
+}
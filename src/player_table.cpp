@@ -0,0 +1,85 @@
+#include "player_table.hpp"
+
+RemotePlayer::RemotePlayer(uint32_t playerId, const sf::Texture &texture)
+    : id(playerId), sprite(texture)
+{
+    // Set the origin for other players here, same as the main player
+    sprite.setOrigin({FRAME_WIDTH / 2.f, FRAME_HEIGHT / 2.f});
+}
+
+PlayerTable::PlayerTable(const sf::Texture &texture)
+    : texture(texture)
+{
+}
+
+RemotePlayer *PlayerTable::find(uint32_t id)
+{
+    auto it = index.find(id);
+    return it != index.end() ? &players[it->second] : nullptr;
+}
+
+const RemotePlayer *PlayerTable::find(uint32_t id) const
+{
+    auto it = index.find(id);
+    return it != index.end() ? &players[it->second] : nullptr;
+}
+
+RemotePlayer &PlayerTable::insert(uint32_t id)
+{
+    if (spareNodes.empty())
+    {
+        index.emplace(id, players.size());
+    }
+    else
+    {
+        Index::node_type node = std::move(spareNodes.back());
+        spareNodes.pop_back();
+        node.key() = id;
+        node.mapped() = players.size();
+        index.insert(std::move(node));
+    }
+    players.emplace_back(id, texture);
+    return players.back();
+}
+
+bool PlayerTable::erase(uint32_t id)
+{
+    Index::node_type node = index.extract(id);
+    if (node.empty())
+        return false;
+
+    std::size_t slot = node.mapped();
+    if (slot != players.size() - 1)
+    {
+        std::swap(players[slot], players.back());
+        index[players[slot].id] = slot;
+    }
+    players.pop_back();
+    spareNodes.push_back(std::move(node));
+    return true;
+}
+
+void PlayerTable::clear()
+{
+    while (!players.empty())
+    {
+        erase(players.back().id);
+    }
+}
+
+void PlayerTable::animate(sf::Time dt)
+{
+    const auto &animData = playerAnimations();
+    for (auto &player : players)
+    {
+        player.animTimer += dt;
+        const AnimationData &data = animData.at(player.animState);
+        if (player.animTimer >= sf::seconds(data.timePerFrame))
+        {
+            player.animTimer -= sf::seconds(data.timePerFrame);
+            player.currentFrame = (player.currentFrame + 1) % data.frameCount;
+            player.sprite.setTextureRect(animationFrameRect(data, player.currentFrame));
+        }
+        player.sprite.setScale({player.facingRight ? 1.f : -1.f, 1.f});
+    }
+}
@@ -0,0 +1,90 @@
+#include "protocol.hpp"
+
+// Packet
+sf::Packet &operator<<(sf::Packet &packet, const PlayerInputState &input)
+{
+    return packet << input.up << input.down << input.left << input.right << input.jump;
+}
+
+sf::Packet &operator>>(sf::Packet &packet, PlayerInputState &input)
+{
+    return packet >> input.up >> input.down >> input.left >> input.right >> input.jump;
+}
+
+sf::Packet &operator<<(sf::Packet &packet, PacketType type)
+{
+    return packet << static_cast<uint8_t>(type);
+}
+
+sf::Packet &operator>>(sf::Packet &packet, PacketType &type)
+{
+    uint8_t value;
+    packet >> value;
+    type = static_cast<PacketType>(value);
+    return packet;
+}
+
+const char *packetTypeName(PacketType type)
+{
+    switch (type)
+    {
+    case PacketType::Welcome:
+        return "Welcome";
+    case PacketType::PlayerState:
+        return "PlayerState";
+    case PacketType::PlayerInput:
+        return "PlayerInput";
+    case PacketType::PlayerJoined:
+        return "PlayerJoined";
+    case PacketType::PlayerLeft:
+        return "PlayerLeft";
+    case PacketType::MapData:
+        return "MapData";
+    case PacketType::ShardInfo:
+        return "ShardInfo";
+    case PacketType::ShardHandoff:
+        return "ShardHandoff";
+    case PacketType::ShardAttach:
+        return "ShardAttach";
+    case PacketType::PackedMapData:
+        return "PackedMapData";
+    case PacketType::ChannelData:
+        return "ChannelData";
+    }
+    return "Unknown";
+}
+
+MessageChannel channelFor(PacketType type)
+{
+    switch (type)
+    {
+    case PacketType::Welcome:
+    case PacketType::ShardInfo:
+    case PacketType::ShardAttach:
+        return MessageChannel::Control;
+    case PacketType::MapData:
+    case PacketType::PackedMapData:
+        return MessageChannel::Bulk;
+    default:
+        return MessageChannel::Realtime; // Joins and leaves stay ordered with the states they bracket
+    }
+}
+
+bool isMapMessage(PacketType type)
+{
+    return type == PacketType::MapData || type == PacketType::PackedMapData;
+}
+
+const char *channelName(MessageChannel channel)
+{
+    switch (channel)
+    {
+    case MessageChannel::Control:
+        return "control";
+    case MessageChannel::Realtime:
+        return "realtime";
+    case MessageChannel::Bulk:
+        return "bulk";
+    }
+    return "unknown";
+}
@@ -0,0 +1,141 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+// Key layout, most significant first: layer (8 bits), texture id (16),
+// depth (32), 8 spare bits left zero so the sort skips that pass
+const int LAYER_SHIFT = 56;
+const int TEXTURE_SHIFT = 40;
+const int DEPTH_SHIFT = 8;
+
+// Maps a float onto uint32 so unsigned order matches numeric order
+uint32_t sortableDepth(float depth)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+} // namespace
+
+uint16_t RenderQueue::textureId(const sf::Texture *texture)
+{
+    if (!texture)
+        return 0;
+    // A handful of textures per frame; a linear scan beats hashing
+    auto it = std::find(textures.begin(), textures.end(), texture);
+    if (it == textures.end())
+    {
+        textures.push_back(texture);
+        it = textures.end() - 1;
+    }
+    return static_cast<uint16_t>(std::min<std::ptrdiff_t>(it - textures.begin() + 1, 0xFFFF));
+}
+
+void RenderQueue::push(RenderLayer layer, float depth, const Item &item)
+{
+    keys.push_back(static_cast<uint64_t>(layer) << LAYER_SHIFT |
+                   static_cast<uint64_t>(textureId(item.texture)) << TEXTURE_SHIFT |
+                   static_cast<uint64_t>(sortableDepth(depth)) << DEPTH_SHIFT);
+    items.push_back(item);
+}
+
+void RenderQueue::submit(RenderLayer layer, const sf::Sprite &sprite, float depth)
+{
+    const sf::IntRect rect = sprite.getTextureRect();
+    const sf::Vector2f size(static_cast<float>(std::abs(rect.size.x)), static_cast<float>(std::abs(rect.size.y)));
+    const sf::Vector2f uv(static_cast<float>(rect.position.x), static_cast<float>(rect.position.y));
+    const sf::Vector2f uvSize(static_cast<float>(rect.size.x), static_cast<float>(rect.size.y));
+    const sf::Transform &transform = sprite.getTransform();
+    const sf::Color color = sprite.getColor();
+
+    Item item;
+    item.texture = &sprite.getTexture();
+    const sf::Vector2f local[4] = {{0.f, 0.f}, {size.x, 0.f}, {size.x, size.y}, {0.f, size.y}};
+    const sf::Vector2f texCoords[4] = {uv, {uv.x + uvSize.x, uv.y}, uv + uvSize, {uv.x, uv.y + uvSize.y}};
+    for (int i = 0; i < 4; ++i)
+        item.corners[i] = {transform.transformPoint(local[i]), color, texCoords[i]};
+    push(layer, depth, item);
+}
+
+void RenderQueue::submit(RenderLayer layer, const sf::RectangleShape &shape, float depth)
+{
+    const sf::Vector2f size = shape.getSize();
+    const sf::Transform &transform = shape.getTransform();
+    const sf::Color color = shape.getFillColor();
+
+    Item item;
+    item.texture = nullptr;
+    const sf::Vector2f local[4] = {{0.f, 0.f}, {size.x, 0.f}, {size.x, size.y}, {0.f, size.y}};
+    for (int i = 0; i < 4; ++i)
+        item.corners[i] = {transform.transformPoint(local[i]), color, {}};
+    push(layer, depth, item);
+}
+
+void RenderQueue::sortKeys()
+{
+    // LSD radix sort on bytes, stable, so equal keys stay in submission
+    // order. Bytes every key shares are skipped, which removes most passes.
+    const std::size_t count = keys.size();
+    order.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+        order[i] = static_cast<uint32_t>(i);
+    keyScratch.resize(count);
+    orderScratch.resize(count);
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::size_t histogram[257] = {};
+        for (uint64_t key : keys)
+            ++histogram[((key >> shift) & 0xFF) + 1];
+        if (count == 0 || histogram[((keys[0] >> shift) & 0xFF) + 1] == count)
+            continue;
+        for (int bucket = 0; bucket < 256; ++bucket)
+            histogram[bucket + 1] += histogram[bucket];
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::size_t slot = histogram[(keys[i] >> shift) & 0xFF]++;
+            keyScratch[slot] = keys[i];
+            orderScratch[slot] = order[i];
+        }
+        keys.swap(keyScratch);
+        order.swap(orderScratch);
+    }
+}
+
+void RenderQueue::flush(sf::RenderTarget &target)
+{
+    stats = Stats();
+    stats.items = items.size();
+    sortKeys();
+
+    // Consecutive items with the same texture share one draw
+    batch.clear();
+    const sf::Texture *batchTexture = nullptr;
+    auto drawBatch = [&]() {
+        if (batch.empty())
+            return;
+        sf::RenderStates states;
+        states.texture = batchTexture;
+        target.draw(batch.data(), batch.size(), sf::PrimitiveType::Triangles, states);
+        ++stats.drawCalls;
+        batch.clear();
+    };
+    for (uint32_t index : order)
+    {
+        const Item &item = items[index];
+        if (item.texture != batchTexture)
+        {
+            drawBatch();
+            batchTexture = item.texture;
+        }
+        const sf::Vertex *c = item.corners;
+        batch.insert(batch.end(), {c[0], c[1], c[2], c[0], c[2], c[3]});
+    }
+    drawBatch();
+
+    items.clear();
+    keys.clear();
+}
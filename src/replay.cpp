@@ -0,0 +1,356 @@
+#include "replay.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+const char HEADER_MAGIC[4] = {'2', 'D', 'P', 'R'};
+const char FOOTER_MAGIC[4] = {'2', 'D', 'P', 'I'};
+const uint32_t FORMAT_VERSION = 4; // 2: messages carry their shard id, 3: input records, 4: packed keyframe tiles
+const uint32_t OLDEST_READABLE_VERSION = 1; // Older captures lack shard ids, inputs or packed tiles
+const uint32_t SHARD_ID_VERSION = 2;
+const uint32_t PACKED_SNAPSHOT_VERSION = 4;
+const std::size_t RECORD_HEADER_SIZE = 1 + 8 + 4;
+const std::size_t FOOTER_SIZE = 8 + 4;
+
+template <typename T>
+void writeLittleEndian(std::ostream &out, T value)
+{
+    char bytes[sizeof(T)];
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        bytes[i] = static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+    out.write(bytes, sizeof(T));
+}
+
+template <typename T>
+bool readLittleEndian(std::istream &in, T &value)
+{
+    unsigned char bytes[sizeof(T)];
+    if (!in.read(reinterpret_cast<char *>(bytes), sizeof(T)))
+        return false;
+    uint64_t result = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        result |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    value = static_cast<T>(result);
+    return true;
+}
+} // namespace
+
+// --- ReplayWriter ---
+
+ReplayWriter::~ReplayWriter()
+{
+    close();
+}
+
+bool ReplayWriter::open(const std::string &path, sf::Time interval)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "Failed to create replay file: " << path << std::endl;
+        return false;
+    }
+    file.write(HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    writeLittleEndian(file, FORMAT_VERSION);
+    keyframeInterval = interval;
+    nextKeyframe = sf::Time::Zero;
+    keyframes.clear();
+    return true;
+}
+
+void ReplayWriter::writeRecordHeader(ReplayRecordKind kind, sf::Time time, std::size_t size)
+{
+    writeLittleEndian(file, static_cast<uint8_t>(kind));
+    writeLittleEndian(file, static_cast<uint64_t>(time.asMicroseconds()));
+    writeLittleEndian(file, static_cast<uint32_t>(size));
+}
+
+void ReplayWriter::writeKeyframeIfDue(sf::Time time, const ClientWorld &world)
+{
+    if (!file.is_open() || time < nextKeyframe)
+        return;
+
+    scratch.clear();
+    writeSnapshot(world, scratch);
+    keyframes.push_back({static_cast<uint64_t>(time.asMicroseconds()), static_cast<uint64_t>(file.tellp())});
+    writeRecordHeader(ReplayRecordKind::Keyframe, time, scratch.getDataSize());
+    file.write(static_cast<const char *>(scratch.getData()), static_cast<std::streamsize>(scratch.getDataSize()));
+    nextKeyframe = time + keyframeInterval;
+}
+
+void ReplayWriter::writeMessage(sf::Time time, uint32_t shardId, const sf::Packet &packet)
+{
+    writeShardPacket(ReplayRecordKind::Message, time, shardId, packet);
+}
+
+void ReplayWriter::writeInput(sf::Time time, uint32_t shardId, const sf::Packet &packet)
+{
+    writeShardPacket(ReplayRecordKind::Input, time, shardId, packet);
+}
+
+void ReplayWriter::writeShardPacket(ReplayRecordKind kind, sf::Time time, uint32_t shardId, const sf::Packet &packet)
+{
+    if (!file.is_open())
+        return;
+    writeRecordHeader(kind, time, sizeof(shardId) + packet.getDataSize());
+    writeLittleEndian(file, shardId);
+    file.write(static_cast<const char *>(packet.getData()), static_cast<std::streamsize>(packet.getDataSize()));
+}
+
+void ReplayWriter::close()
+{
+    if (!file.is_open())
+        return;
+
+    uint64_t indexOffset = static_cast<uint64_t>(file.tellp());
+    writeLittleEndian(file, static_cast<uint32_t>(keyframes.size()));
+    for (const auto &entry : keyframes)
+    {
+        writeLittleEndian(file, entry.timeMicros);
+        writeLittleEndian(file, entry.offset);
+    }
+    writeLittleEndian(file, indexOffset);
+    file.write(FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+    file.close();
+}
+
+// --- ReplayReader ---
+
+bool ReplayReader::open(const std::string &path)
+{
+    file.open(path, std::ios::binary);
+    char magic[4];
+    uint32_t version;
+    if (!file || !file.read(magic, sizeof(magic)) || !std::equal(magic, magic + 4, HEADER_MAGIC) ||
+        !readLittleEndian(file, version) || version < OLDEST_READABLE_VERSION || version > FORMAT_VERSION)
+    {
+        std::cerr << "Not a replay file: " << path << std::endl;
+        return false;
+    }
+    format.shardIds = version >= SHARD_ID_VERSION;
+    format.packedTiles = version >= PACKED_SNAPSHOT_VERSION;
+
+    if (!loadIndex() && !scanIndex())
+    {
+        std::cerr << "Failed to index replay file: " << path << std::endl;
+        return false;
+    }
+    if (keyframes.empty())
+    {
+        std::cerr << "Replay file has no keyframes: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReplayReader::loadIndex()
+{
+    file.seekg(0, std::ios::end);
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+    if (fileSize < 8 + FOOTER_SIZE)
+        return false;
+
+    uint64_t indexOffset;
+    char magic[4];
+    file.seekg(static_cast<std::streamoff>(fileSize - FOOTER_SIZE));
+    if (!readLittleEndian(file, indexOffset) || !file.read(magic, sizeof(magic)) ||
+        !std::equal(magic, magic + 4, FOOTER_MAGIC) || indexOffset >= fileSize)
+    {
+        file.clear();
+        return false;
+    }
+
+    uint32_t count;
+    file.seekg(static_cast<std::streamoff>(indexOffset));
+    if (!readLittleEndian(file, count))
+        return false;
+    // Check the count against the bytes that follow before allocating for it
+    const uint64_t indexEnd = fileSize - FOOTER_SIZE;
+    const uint64_t entrySize = sizeof(uint64_t) + sizeof(uint64_t);
+    if (indexOffset + sizeof(count) > indexEnd || count > (indexEnd - indexOffset - sizeof(count)) / entrySize)
+        return false;
+    keyframes.resize(count);
+    for (auto &entry : keyframes)
+    {
+        if (!readLittleEndian(file, entry.timeMicros) || !readLittleEndian(file, entry.offset))
+            return false;
+    }
+    recordsEnd = indexOffset;
+
+    // The last record's timestamp is the capture length; walk from the final keyframe
+    endTime = keyframes.empty() ? sf::Time::Zero : sf::microseconds(static_cast<int64_t>(keyframes.back().timeMicros));
+    if (!keyframes.empty())
+    {
+        file.seekg(static_cast<std::streamoff>(keyframes.back().offset));
+        while (peekRecord() == Peek::Record)
+        {
+            endTime = pendingTime;
+            file.seekg(pendingSize, std::ios::cur);
+        }
+        file.clear();
+    }
+    return true;
+}
+
+bool ReplayReader::scanIndex()
+{
+    // Capture was cut short: rebuild the index with one pass over the records
+    std::cout << "Replay has no index, scanning..." << std::endl;
+    file.clear();
+    file.seekg(0, std::ios::end);
+    recordsEnd = static_cast<uint64_t>(file.tellg());
+    file.seekg(8);
+    keyframes.clear();
+    uint64_t offset = 8;
+    while (peekRecord() == Peek::Record)
+    {
+        if (pendingKind == static_cast<uint8_t>(ReplayRecordKind::Keyframe))
+            keyframes.push_back({static_cast<uint64_t>(pendingTime.asMicroseconds()), offset});
+        endTime = pendingTime;
+        offset += RECORD_HEADER_SIZE + pendingSize;
+        file.seekg(static_cast<std::streamoff>(offset));
+    }
+    file.clear();
+    return true;
+}
+
+ReplayReader::Peek ReplayReader::peekRecord()
+{
+    auto offset = static_cast<uint64_t>(file.tellg());
+    if (!file || offset + RECORD_HEADER_SIZE > recordsEnd)
+        return Peek::End;
+
+    uint64_t timeMicros;
+    if (!readLittleEndian(file, pendingKind) || !readLittleEndian(file, timeMicros) ||
+        !readLittleEndian(file, pendingSize))
+        return Peek::Error;
+    if (offset + RECORD_HEADER_SIZE + pendingSize > recordsEnd)
+        return Peek::End; // Truncated trailing record
+    pendingTime = sf::microseconds(static_cast<int64_t>(timeMicros));
+    return Peek::Record;
+}
+
+bool ReplayReader::readShardId(uint32_t &shardId)
+{
+    shardId = INITIAL_SHARD_ID;
+    if (!format.shardIds)
+        return true;
+    if (pendingSize < sizeof(shardId) || !readLittleEndian(file, shardId))
+        return false;
+    pendingSize -= sizeof(shardId);
+    return true;
+}
+
+bool ReplayReader::readPayload(sf::Packet &packet)
+{
+    payload.resize(pendingSize);
+    if (pendingSize > 0 && !file.read(payload.data(), pendingSize))
+        return false;
+    packet.clear();
+    packet.append(payload.data(), payload.size());
+    return true;
+}
+
+bool ReplayReader::seek(sf::Time time, ClientWorld &world)
+{
+    // Last keyframe at or before the target
+    uint64_t target = static_cast<uint64_t>(std::max(time, sf::Time::Zero).asMicroseconds());
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), target,
+                               [](uint64_t value, const IndexEntry &entry) { return value < entry.timeMicros; });
+    const IndexEntry &keyframe = it == keyframes.begin() ? keyframes.front() : *std::prev(it);
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(keyframe.offset));
+    sf::Packet packet;
+    if (peekRecord() != Peek::Record || pendingKind != static_cast<uint8_t>(ReplayRecordKind::Keyframe) ||
+        !readPayload(packet) || !readSnapshot(world, packet, format))
+    {
+        std::cerr << "Corrupt replay keyframe at offset " << keyframe.offset << std::endl;
+        return false;
+    }
+    playhead = pendingTime;
+    atEnd = false;
+    advance(time, world);
+    return true;
+}
+
+std::size_t ReplayReader::advance(sf::Time time, ClientWorld &world)
+{
+    std::size_t applied = 0;
+    sf::Packet packet;
+    while (!atEnd)
+    {
+        auto recordStart = file.tellg();
+        Peek peek = peekRecord();
+        if (peek != Peek::Record)
+        {
+            atEnd = true;
+            break;
+        }
+        if (pendingTime > time)
+        {
+            file.seekg(recordStart); // Not due yet, read it again next frame
+            break;
+        }
+        if (pendingKind != static_cast<uint8_t>(ReplayRecordKind::Message))
+        {
+            file.seekg(pendingSize, std::ios::cur); // Keyframes only matter when seeking, inputs never
+            continue;
+        }
+        uint32_t shardId;
+        if (!readShardId(shardId) || !readPayload(packet))
+        {
+            atEnd = true;
+            break;
+        }
+
+        PacketType type;
+        if (packet >> type)
+            applyPacket(world, type, packet, shardId);
+        playhead = pendingTime;
+        ++applied;
+    }
+    if (playhead < time && !atEnd)
+        playhead = time;
+    return applied;
+}
+
+void ReplayReader::rewind()
+{
+    file.clear();
+    file.seekg(8); // Past the header
+    playhead = sf::Time::Zero;
+    atEnd = false;
+}
+
+bool ReplayReader::readRecord(ReplayRecord &record)
+{
+    while (!atEnd)
+    {
+        if (peekRecord() != Peek::Record)
+            break;
+        record.kind = static_cast<ReplayRecordKind>(pendingKind);
+        record.time = pendingTime;
+        record.shardId = 0;
+        switch (record.kind)
+        {
+        case ReplayRecordKind::Message:
+        case ReplayRecordKind::Input:
+            if (!readShardId(record.shardId))
+                break;
+            [[fallthrough]];
+        case ReplayRecordKind::Keyframe:
+            if (!readPayload(record.packet))
+                break;
+            playhead = pendingTime;
+            return true;
+        default:
+            file.seekg(pendingSize, std::ios::cur); // Written by a newer client
+            continue;
+        }
+        break; // Malformed record
+    }
+    atEnd = true;
+    return false;
+}
@@ -0,0 +1,302 @@
+#include "shard_set.hpp"
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <string>
+
+namespace
+{
+const sf::Time SHARD_CONNECT_TIMEOUT = sf::seconds(1); // Retry a connect that has not completed by then
+const std::size_t MAX_QUEUED_PACKETS = 64;              // Past this the shard is not reading; drop new packets
+
+// Dotted IPv4 only. sf::IpAddress::resolve would also accept host names and
+// look them up with a blocking DNS query on the game thread.
+std::optional<sf::IpAddress> parseNumericAddress(const std::string &text)
+{
+    uint8_t octets[4];
+    std::size_t pos = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i > 0 && (pos >= text.size() || text[pos++] != '.'))
+            return std::nullopt;
+        unsigned value = 0;
+        std::size_t digits = 0;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9' && digits < 3)
+        {
+            value = value * 10 + static_cast<unsigned>(text[pos++] - '0');
+            ++digits;
+        }
+        if (digits == 0 || value > 255)
+            return std::nullopt;
+        octets[i] = static_cast<uint8_t>(value);
+    }
+    if (pos != text.size())
+        return std::nullopt;
+    return sf::IpAddress(octets[0], octets[1], octets[2], octets[3]);
+}
+} // namespace
+
+ShardSet::Shard::Shard(ShardSet &shardSet, uint32_t shardId, sf::IpAddress shardAddress, unsigned short shardPort)
+    : owner(shardSet), id(shardId), address(shardAddress), port(shardPort)
+{
+}
+
+void ShardSet::Shard::onMessage(PacketType type, sf::Packet &packet)
+{
+    packetsReceived->add();
+    if (type != PacketType::ShardInfo)
+    {
+        owner.handler->onMessage(id, type, packet);
+        return;
+    }
+
+    // The handler's applyPacket relabels the world; keep a copy for the neighbour list
+    sf::Packet info = packet;
+    const bool fromAuthority = id == owner.world.myShardId;
+    owner.handler->onMessage(id, type, packet);
+    owner.applyShardInfo(*this, fromAuthority, info);
+}
+
+void ShardSet::Shard::onMapBegin(uint32_t width, uint32_t height)
+{
+    packetsReceived->add();
+    owner.handler->onMapBegin(id, width, height);
+}
+
+void ShardSet::Shard::onMapTiles(std::size_t firstTile, const int32_t *tiles, std::size_t count)
+{
+    owner.handler->onMapTiles(id, firstTile, tiles, count);
+}
+
+void ShardSet::Shard::onMapEnd(bool complete)
+{
+    owner.handler->onMapEnd(id, complete);
+}
+
+ShardSet::ShardSet(ClientWorld &clientWorld)
+    : world(clientWorld),
+      connectedShards(metricsRegistry().gauge("client_shards_connected", "Shard connections currently open."))
+{
+}
+
+void ShardSet::connectInitial(sf::IpAddress address, unsigned short port)
+{
+    addShard(INITIAL_SHARD_ID, address, port);
+}
+
+ShardSet::Shard &ShardSet::addShard(uint32_t id, sf::IpAddress address, unsigned short port)
+{
+    shards.push_back(std::make_unique<Shard>(*this, id, address, port));
+    Shard &shard = *shards.back();
+    registerMetrics(shard);
+    startConnect(shard);
+    return shard;
+}
+
+void ShardSet::registerMetrics(Shard &shard)
+{
+    MetricsRegistry &registry = metricsRegistry();
+    const std::string label = "shard=\"" + std::to_string(shard.id) + "\"";
+    shard.bytesReceived = &registry.counter("client_shard_received_bytes_total", "Bytes received per shard.", label);
+    shard.packetsReceived = &registry.counter("client_shard_received_packets_total", "Packets received per shard.", label);
+    shard.bytesSent = &registry.counter("client_shard_sent_bytes_total", "Bytes sent per shard.", label);
+    shard.packetsSent = &registry.counter("client_shard_sent_packets_total", "Packets sent per shard.", label);
+}
+
+void ShardSet::startConnect(Shard &shard)
+{
+    // Non-blocking, so a slow neighbour never holds up the frame
+    shard.socket.disconnect();
+    shard.outgoing.clear(); // A partly sent packet cannot continue on a new connection
+    shard.socket.setBlocking(false);
+    shard.state = State::Connecting;
+    shard.connectTimer.restart();
+    if (shard.socket.connect(shard.address, shard.port) == sf::Socket::Status::Done)
+    {
+        onConnected(shard);
+    }
+}
+
+void ShardSet::onConnected(Shard &shard)
+{
+    shard.state = State::Connected;
+    hadConnection = true;
+    std::cout << "Connected to shard " << shard.id << " at " << shard.address.toString() << ":" << shard.port
+              << std::endl;
+
+    if (shard.id != world.myShardId)
+    {
+        // Neighbour: ask it to mirror the entities near its border with ours
+        sf::Packet attach;
+        attach << PacketType::ShardAttach << world.myPlayerId;
+        queueSend(shard, attach);
+    }
+}
+
+void ShardSet::poll(Handler &pollHandler)
+{
+    handler = &pollHandler;
+    for (std::size_t i = 0; i < shards.size(); ++i)
+    {
+        Shard &shard = *shards[i];
+        if (shard.state == State::Connecting)
+        {
+            if (shard.socket.getRemoteAddress())
+                onConnected(shard);
+            else if (shard.connectTimer.getElapsedTime() >= SHARD_CONNECT_TIMEOUT)
+                startConnect(shard);
+        }
+        if (shard.state == State::Connected && (!flushOutgoing(shard) || !receiveAll(shard)))
+        {
+            std::cerr << "Disconnected from shard " << shard.id << "." << std::endl;
+            shard.stream.abort(shard);
+            if (lastAuthority == &shard)
+                lastAuthority = nullptr;
+            if (shard.id != world.myShardId)
+                dropShardPlayers(world, shard.id);
+            shards.erase(shards.begin() + static_cast<std::ptrdiff_t>(i));
+            --i;
+        }
+    }
+
+    removeUnwanted();
+    if (Shard *authority = authorityConnection())
+        lastAuthority = authority;
+
+    connectedShards.set(static_cast<double>(std::count_if(
+        shards.begin(), shards.end(), [](const auto &shard) { return shard->state == State::Connected; })));
+    handler = nullptr;
+}
+
+bool ShardSet::receiveAll(Shard &shard)
+{
+    // Raw reads: the stream decodes frames itself so large messages parse while arriving
+    while (true)
+    {
+        std::size_t received = 0;
+        sf::Socket::Status status = shard.socket.receive(receiveBuffer, sizeof(receiveBuffer), received);
+        if (status == sf::Socket::Status::Disconnected || status == sf::Socket::Status::Error)
+            return false;
+        if (status != sf::Socket::Status::Done || received == 0)
+            return true; // Nothing more this frame
+
+        shard.bytesReceived->add(received);
+        shard.stream.feed(receiveBuffer, received, shard);
+    }
+}
+
+bool ShardSet::queueSend(Shard &shard, const sf::Packet &packet)
+{
+    if (shard.outgoing.size() >= MAX_QUEUED_PACKETS)
+        return false;
+    shard.outgoing.push_back(packet);
+    return flushOutgoing(shard);
+}
+
+bool ShardSet::flushOutgoing(Shard &shard)
+{
+    while (!shard.outgoing.empty())
+    {
+        // Sending the same packet again continues where a partial send stopped
+        sf::Packet &packet = shard.outgoing.front();
+        const sf::Socket::Status status = shard.socket.send(packet);
+        if (status == sf::Socket::Status::Partial || status == sf::Socket::Status::NotReady)
+            return true;
+        if (status != sf::Socket::Status::Done)
+            return false;
+        shard.packetsSent->add();
+        shard.bytesSent->add(packet.getDataSize() + PACKET_SIZE_PREFIX);
+        shard.outgoing.pop_front();
+    }
+    return true;
+}
+
+void ShardSet::applyShardInfo(Shard &sender, bool fromAuthority, sf::Packet &packet)
+{
+    uint32_t senderId, count;
+    if (!(packet >> senderId >> count))
+    {
+        std::cerr << "Failed to read shard info" << std::endl;
+        return;
+    }
+
+    // Only the authority decides which neighbours we keep
+    if (!fromAuthority)
+        return;
+
+    if (sender.id != senderId)
+    {
+        // applyPacket has already moved the world over to the reported id
+        sender.id = senderId;
+        registerMetrics(sender);
+    }
+
+    for (auto &shard : shards)
+    {
+        shard->wanted = shard.get() == &sender;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t id;
+        std::string host;
+        uint16_t port;
+        if (!(packet >> id >> host >> port))
+        {
+            std::cerr << "Failed to read shard info entry" << std::endl;
+            return;
+        }
+
+        auto existing = std::find_if(shards.begin(), shards.end(), [id](const auto &shard) { return shard->id == id; });
+        if (existing != shards.end())
+        {
+            (*existing)->wanted = true;
+            continue;
+        }
+        std::optional<sf::IpAddress> address = parseNumericAddress(host);
+        if (!address)
+        {
+            std::cerr << "Shard " << id << " host is not a numeric IPv4 address: " << host << std::endl;
+            continue;
+        }
+        addShard(id, *address, port).wanted = true;
+    }
+}
+
+void ShardSet::removeUnwanted()
+{
+    for (auto it = shards.begin(); it != shards.end();)
+    {
+        Shard &shard = **it;
+        if (shard.wanted || shard.id == world.myShardId)
+        {
+            ++it;
+            continue;
+        }
+        std::cout << "Leaving shard " << shard.id << std::endl;
+        dropShardPlayers(world, shard.id);
+        if (lastAuthority == &shard)
+            lastAuthority = nullptr;
+        it = shards.erase(it);
+    }
+}
+
+ShardSet::Shard *ShardSet::authorityConnection() const
+{
+    for (const auto &shard : shards)
+    {
+        if (shard->id == world.myShardId && shard->state == State::Connected)
+            return shard.get();
+    }
+    return nullptr;
+}
+
+bool ShardSet::sendToAuthority(sf::Packet &packet)
+{
+    Shard *target = authorityConnection();
+    if (!target)
+        target = lastAuthority;
+    if (!target)
+        return false;
+
+    return queueSend(*target, packet);
+}
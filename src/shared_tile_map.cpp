@@ -0,0 +1,255 @@
+#include "shared_tile_map.hpp"
+#include <algorithm>
+
+namespace
+{
+int chunksAlong(int tiles)
+{
+    return (tiles + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+}
+
+int chunkExtent(int tiles, int chunk)
+{
+    return std::min(TILE_CHUNK_SIZE, tiles - chunk * TILE_CHUNK_SIZE);
+}
+
+// What one publish leaves behind for epochDomain() to free
+struct RetiredTiles
+{
+    const TileMapVersion *version;
+    std::vector<TileChunk *> chunks;
+};
+
+void destroyRetired(void *object)
+{
+    auto *retired = static_cast<RetiredTiles *>(object);
+    for (TileChunk *chunk : retired->chunks)
+        delete chunk;
+    delete retired->version;
+    delete retired;
+}
+
+} // namespace
+
+// --- TileMapVersion ---
+
+void TileMapVersion::unpackRow(int y, int32_t *out) const
+{
+    const std::size_t first = static_cast<std::size_t>(y / TILE_CHUNK_SIZE) * chunksX;
+    for (int cx = 0; cx < chunksX; ++cx)
+        chunks[first + cx]->tiles.unpackRow(y % TILE_CHUNK_SIZE, out + cx * TILE_CHUNK_SIZE);
+}
+
+void TileMapVersion::copyTo(TileGrid &grid) const
+{
+    grid.reset(mapWidth, mapHeight);
+    std::vector<int32_t> row(static_cast<std::size_t>(mapWidth));
+    for (int y = 0; y < mapHeight; ++y)
+    {
+        unpackRow(y, row.data());
+        grid.setRow(y, 0, row.data(), row.size());
+    }
+}
+
+std::size_t TileMapVersion::memoryBytes() const
+{
+    // Shared chunks are counted once
+    std::vector<const TileChunk *> distinct(chunks.begin(), chunks.end());
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    std::size_t bytes = sizeof(TileMapVersion) + chunks.size() * sizeof(TileChunk *);
+    for (const TileChunk *chunk : distinct)
+        bytes += sizeof(TileChunk) + chunk->tiles.memoryBytes();
+    return bytes;
+}
+
+// --- SharedTileMap ---
+
+SharedTileMap::SharedTileMap()
+{
+    reset(0, 0);
+}
+
+SharedTileMap::~SharedTileMap()
+{
+    // Readers must be done with the map; the last version goes the usual way
+    std::vector<TileChunk *> dead;
+    releaseCurrent(dead);
+    auto *retired = new RetiredTiles{current.load(std::memory_order_relaxed), std::move(dead)};
+    epochDomain().retire(retired, destroyRetired);
+    epochDomain().collect();
+}
+
+void SharedTileMap::releaseCurrent(std::vector<TileChunk *> &dead)
+{
+    const TileMapVersion *version = current.load(std::memory_order_relaxed);
+    if (!version)
+        return;
+    for (TileChunk *chunk : version->chunks)
+    {
+        if (--chunk->references == 0)
+            dead.push_back(chunk);
+    }
+}
+
+void SharedTileMap::reset(int width, int height)
+{
+    auto *next = new TileMapVersion();
+    next->mapWidth = std::max(width, 0);
+    next->mapHeight = std::max(height, 0);
+    next->chunksX = chunksAlong(next->mapWidth);
+    const int chunksY = chunksAlong(next->mapHeight);
+    next->chunks.reserve(static_cast<std::size_t>(next->chunksX) * chunksY);
+
+    // At most four chunk shapes: full, short last column, short last row, corner
+    std::vector<TileChunk *> blanks;
+    for (int cy = 0; cy < chunksY; ++cy)
+    {
+        for (int cx = 0; cx < next->chunksX; ++cx)
+        {
+            const int w = chunkExtent(next->mapWidth, cx);
+            const int h = chunkExtent(next->mapHeight, cy);
+            auto blank = std::find_if(blanks.begin(), blanks.end(), [w, h](const TileChunk *chunk) {
+                return chunk->tiles.width() == w && chunk->tiles.height() == h;
+            });
+            if (blank == blanks.end())
+            {
+                auto *chunk = new TileChunk();
+                chunk->tiles.reset(w, h);
+                chunk->references = 0;
+                blanks.push_back(chunk);
+                blank = blanks.end() - 1;
+            }
+            ++(*blank)->references;
+            next->chunks.push_back(*blank);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writerMutex);
+    std::vector<TileChunk *> dead;
+    releaseCurrent(dead);
+    publish(next, std::move(dead));
+}
+
+void SharedTileMap::assign(const TileGrid &grid)
+{
+    auto *next = new TileMapVersion();
+    next->mapWidth = grid.width();
+    next->mapHeight = grid.height();
+    next->chunksX = chunksAlong(next->mapWidth);
+    const int chunksY = chunksAlong(next->mapHeight);
+    next->chunks.resize(static_cast<std::size_t>(next->chunksX) * chunksY);
+    for (int cy = 0; cy < chunksY; ++cy)
+    {
+        for (int cx = 0; cx < next->chunksX; ++cx)
+        {
+            auto *chunk = new TileChunk();
+            chunk->tiles.reset(chunkExtent(next->mapWidth, cx), chunkExtent(next->mapHeight, cy));
+            next->chunks[static_cast<std::size_t>(cy) * next->chunksX + cx] = chunk;
+        }
+    }
+
+    std::vector<int32_t> row(static_cast<std::size_t>(grid.width()));
+    for (int y = 0; y < grid.height(); ++y)
+    {
+        grid.unpackRow(y, row.data());
+        const std::size_t first = static_cast<std::size_t>(y / TILE_CHUNK_SIZE) * next->chunksX;
+        for (int cx = 0; cx < next->chunksX; ++cx)
+        {
+            TileGrid &tiles = next->chunks[first + cx]->tiles;
+            tiles.setRow(y % TILE_CHUNK_SIZE, 0, row.data() + cx * TILE_CHUNK_SIZE,
+                         static_cast<std::size_t>(tiles.width()));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writerMutex);
+    std::vector<TileChunk *> dead;
+    releaseCurrent(dead);
+    publish(next, std::move(dead));
+}
+
+void SharedTileMap::publish(TileMapVersion *next, std::vector<TileChunk *> dead)
+{
+    next->versionNumber = versionsPublished++;
+    const TileMapVersion *previous = current.exchange(next, std::memory_order_seq_cst);
+    if (previous)
+        epochDomain().retire(new RetiredTiles{previous, std::move(dead)}, destroyRetired);
+    epochDomain().collect();
+}
+
+SharedTileMap::Stats SharedTileMap::stats() const
+{
+    std::lock_guard<std::mutex> lock(writerMutex);
+    Stats result;
+    result.versionsPublished = versionsPublished;
+    result.chunksCopied = chunksCopied;
+    return result;
+}
+
+// --- TilePatch ---
+
+TilePatch::TilePatch(SharedTileMap &tileMap) : map(tileMap), lock(tileMap.writerMutex)
+{
+}
+
+TilePatch::~TilePatch()
+{
+    commit();
+}
+
+TileGrid &TilePatch::writableChunk(int chunkX, int chunkY)
+{
+    if (!next)
+    {
+        // The writer lock keeps current stable, so no pin is needed
+        next = new TileMapVersion(*map.current.load(std::memory_order_relaxed));
+        copied.assign(next->chunks.size(), false);
+    }
+
+    const std::size_t index = static_cast<std::size_t>(chunkY) * next->chunksX + chunkX;
+    TileChunk *&chunk = next->chunks[index];
+    if (!copied[index])
+    {
+        auto *copy = new TileChunk();
+        copy->tiles = chunk->tiles;
+        if (--chunk->references == 0)
+            dead.push_back(chunk); // Readers of the current version may still use it
+        chunk = copy;
+        copied[index] = true;
+        ++map.chunksCopied;
+    }
+    return chunk->tiles;
+}
+
+void TilePatch::set(int x, int y, int value)
+{
+    if (!lock.owns_lock())
+        return;
+    writableChunk(x / TILE_CHUNK_SIZE, y / TILE_CHUNK_SIZE).set(x % TILE_CHUNK_SIZE, y % TILE_CHUNK_SIZE, value);
+}
+
+void TilePatch::setRow(int y, int firstX, const int32_t *values, std::size_t count)
+{
+    // Split at chunk borders
+    while (count > 0 && lock.owns_lock())
+    {
+        const std::size_t inChunk = TILE_CHUNK_SIZE - firstX % TILE_CHUNK_SIZE;
+        const std::size_t n = std::min(count, inChunk);
+        writableChunk(firstX / TILE_CHUNK_SIZE, y / TILE_CHUNK_SIZE)
+            .setRow(y % TILE_CHUNK_SIZE, firstX % TILE_CHUNK_SIZE, values, n);
+        firstX += static_cast<int>(n);
+        values += n;
+        count -= n;
+    }
+}
+
+void TilePatch::commit()
+{
+    if (!lock.owns_lock())
+        return;
+    if (next)
+        map.publish(next, std::move(dead));
+    next = nullptr;
+    dead.clear();
+    lock.unlock();
+}
@@ -0,0 +1,212 @@
+#include "soak_test.hpp"
+#include "byte_codec.hpp"
+#include "client_world.hpp"
+#include "memory_stats.hpp"
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+// Produces the packet stream a busy server would send: a welcome and a map,
+// then players endlessly joining, moving and leaving.
+class StandInServer
+{
+public:
+    explicit StandInServer(const SoakOptions &options)
+        : options(options), random(12345)
+    {
+    }
+
+    void writeWelcome(sf::Packet &packet)
+    {
+        packet.clear();
+        packet << PacketType::Welcome << LOCAL_PLAYER_ID;
+    }
+
+    void writeMap(sf::Packet &packet)
+    {
+        const uint32_t width = 100, height = 30;
+        packet.clear();
+        packet << PacketType::MapData << width << height;
+        std::vector<int32_t> row(width);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+                row[x] = (y == height - 1 || x == 0 || x == width - 1) ? 1 : 0;
+            writeArray(packet, row.data(), row.size());
+        }
+    }
+
+    // Calls deliver(packet) for every packet of one churn cycle
+    template <typename Deliver>
+    void cycle(sf::Packet &packet, Deliver &&deliver)
+    {
+        std::uniform_real_distribution<float> coordinate(0.f, 4000.f);
+
+        uint32_t joiningId = nextId++;
+        packet.clear();
+        packet << PacketType::PlayerJoined << joiningId << coordinate(random) << coordinate(random) << true;
+        deliver(packet);
+        live.push_back(joiningId);
+
+        for (uint32_t i = 0; i < options.statesPerCycle; ++i)
+        {
+            uint32_t id = live[random() % live.size()];
+            packet.clear();
+            packet << PacketType::PlayerState << id << coordinate(random) << coordinate(random) << (random() % 4 != 0);
+            deliver(packet);
+        }
+
+        if (live.size() > options.population)
+        {
+            // Oldest player leaves, keeping the population steady
+            uint32_t leavingId = live.front();
+            live.pop_front();
+            packet.clear();
+            packet << PacketType::PlayerLeft << leavingId;
+            deliver(packet);
+        }
+    }
+
+    static const uint32_t LOCAL_PLAYER_ID = 0;
+
+private:
+    const SoakOptions &options;
+    std::mt19937 random;
+    std::deque<uint32_t> live; // Join order, oldest first
+    uint32_t nextId = LOCAL_PLAYER_ID + 1;
+};
+
+struct SoakSample
+{
+    uint64_t cycle;
+    std::size_t residentBytes;
+    HeapStats heap;
+    double frameP50Ms;
+    double frameP99Ms;
+    double frameMaxMs;
+};
+
+double averageOf(const std::vector<SoakSample> &samples, std::size_t begin, std::size_t end,
+                 std::size_t (*field)(const SoakSample &))
+{
+    double total = 0.0;
+    for (std::size_t i = begin; i < end; ++i)
+        total += static_cast<double>(field(samples[i]));
+    return end > begin ? total / static_cast<double>(end - begin) : 0.0;
+}
+
+std::size_t residentOf(const SoakSample &sample) { return sample.residentBytes; }
+std::size_t heapInUseOf(const SoakSample &sample) { return sample.heap.inUseBytes; }
+} // namespace
+
+int runSoakTest(const SoakOptions &options)
+{
+    sf::Texture texture; // Never uploaded, so no window or GL context is needed
+    ClientWorld world(texture);
+    world.logEvents = false;
+    StandInServer server(options);
+
+    auto deliver = [&world](sf::Packet &packet) {
+        PacketType type;
+        if (!(packet >> type) || !applyPacket(world, type, packet))
+        {
+            std::cerr << "Soak: stand-in server produced a packet the client rejected" << std::endl;
+        }
+    };
+
+    sf::Packet packet;
+    server.writeWelcome(packet);
+    deliver(packet);
+    server.writeMap(packet);
+    deliver(packet);
+
+    const uint64_t sampleEvery = std::max<uint64_t>(1, options.cycles / std::max<uint32_t>(1, options.samples));
+    const uint32_t cyclesPerFrame = std::max<uint32_t>(1, options.cyclesPerFrame);
+    const sf::Time frameStep = sf::seconds(1.f / 60.f);
+
+    std::vector<SoakSample> samples;
+    samples.reserve(options.samples + 1);
+    std::vector<int64_t> frameMicros; // Frame times since the last sample
+    frameMicros.reserve(sampleEvery / cyclesPerFrame + 2);
+
+    std::cout << "cycle,rss_bytes,heap_in_use_bytes,heap_free_bytes,frame_p50_ms,frame_p99_ms,frame_max_ms" << std::endl;
+
+    sf::Clock frameClock;
+    for (uint64_t cycle = 1; cycle <= options.cycles; ++cycle)
+    {
+        server.cycle(packet, deliver);
+
+        if (cycle % cyclesPerFrame == 0)
+        {
+            world.otherPlayers.animate(frameStep);
+            frameMicros.push_back(frameClock.restart().asMicroseconds());
+        }
+
+        if (cycle % sampleEvery == 0 || cycle == options.cycles)
+        {
+            SoakSample sample{cycle, residentMemoryBytes(), heapStats(), 0.0, 0.0, 0.0};
+            if (!frameMicros.empty())
+            {
+                auto percentile = [&frameMicros](double p) {
+                    auto nth = frameMicros.begin() + static_cast<std::ptrdiff_t>(p * (frameMicros.size() - 1));
+                    std::nth_element(frameMicros.begin(), nth, frameMicros.end());
+                    return *nth / 1000.0;
+                };
+                sample.frameP50Ms = percentile(0.5);
+                sample.frameP99Ms = percentile(0.99);
+                sample.frameMaxMs = *std::max_element(frameMicros.begin(), frameMicros.end()) / 1000.0;
+                frameMicros.clear();
+            }
+            samples.push_back(sample);
+            std::cout << sample.cycle << ',' << sample.residentBytes << ',' << sample.heap.inUseBytes << ','
+                      << sample.heap.freeBytes << ',' << sample.frameP50Ms << ',' << sample.frameP99Ms << ','
+                      << sample.frameMaxMs << std::endl;
+            frameClock.restart(); // Don't charge the sampling itself to the next frame
+        }
+    }
+
+    bool passed = true;
+    if (world.otherPlayers.size() != options.population)
+    {
+        std::cerr << "Soak: expected " << options.population << " remote players, found "
+                  << world.otherPlayers.size() << std::endl;
+        passed = false;
+    }
+
+    // Compare the first and last quarter of the post-warm-up samples
+    std::size_t warmup = static_cast<std::size_t>(samples.size() * options.warmupFraction);
+    std::size_t steady = samples.size() - warmup;
+    if (steady < 4)
+    {
+        std::cerr << "Soak: too few samples after warm-up to judge memory growth" << std::endl;
+        return 1;
+    }
+    std::size_t quarter = steady / 4;
+    auto growth = [&](std::size_t (*field)(const SoakSample &)) {
+        return averageOf(samples, samples.size() - quarter, samples.size(), field) -
+               averageOf(samples, warmup, warmup + quarter, field);
+    };
+
+    double rssGrowth = growth(residentOf);
+    std::cout << "RSS growth after warm-up: " << rssGrowth << " bytes" << std::endl;
+    if (rssGrowth > static_cast<double>(options.growthToleranceBytes))
+        passed = false;
+
+    const HeapStats &lastHeap = samples.back().heap;
+    if (lastHeap.available)
+    {
+        double heapGrowth = growth(heapInUseOf);
+        double held = static_cast<double>(lastHeap.inUseBytes + lastHeap.freeBytes);
+        std::cout << "Heap in-use growth after warm-up: " << heapGrowth << " bytes, fragmentation "
+                  << (held > 0 ? 100.0 * lastHeap.freeBytes / held : 0.0) << "% free" << std::endl;
+        if (heapGrowth > static_cast<double>(options.growthToleranceBytes))
+            passed = false;
+    }
+
+    std::cout << (passed ? "Soak test passed" : "Soak test FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
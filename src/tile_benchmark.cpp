@@ -0,0 +1,202 @@
+#include "tile_benchmark.hpp"
+#include "shared_tile_map.hpp"
+#include <SFML/System.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+const int BENCH_MAP_WIDTH = 2048;
+const int BENCH_MAP_HEIGHT = 512;
+const int BENCH_PATCHES = 20000;
+const int BENCH_TILES_PER_PATCH = 16;
+const int BENCH_READS_PER_QUERY = 64; // Random lookups per reader query, like a collision sweep
+
+// Tiles in far-apart chunks that every patch sets to the same stamp; a
+// reader that sees them differ has seen half of a patch
+const int SENTINELS[][2] = {{0, 0}, {BENCH_MAP_WIDTH - 1, 0}, {0, BENCH_MAP_HEIGHT - 1},
+                            {BENCH_MAP_WIDTH - 1, BENCH_MAP_HEIGHT - 1}};
+
+struct RunResult
+{
+    double patchesPerSecond = 0.0;
+    double readsPerSecond = 0.0;
+    uint64_t tornSnapshots = 0;
+    std::size_t peakRetired = 0;
+};
+
+TileGrid makeMap()
+{
+    TileGrid grid;
+    grid.reset(BENCH_MAP_WIDTH, BENCH_MAP_HEIGHT);
+    std::mt19937 random(11);
+    for (int y = 0; y < BENCH_MAP_HEIGHT; ++y)
+    {
+        for (int x = 0; x < BENCH_MAP_WIDTH; ++x)
+            grid.set(x, y, random() % 8 == 0 ? 1 : 0);
+    }
+    return grid;
+}
+
+// Runs the writer on this thread and readerCount query threads until the
+// writer is done. Map supplies read(query) and patch(tiles, stamp).
+template <typename Map>
+RunResult run(Map &map, int readerCount)
+{
+    epochDomain().collect(); // Leftovers from the previous run would count as this one's
+    std::atomic<bool> writing{true};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; ++r)
+    {
+        readers.emplace_back([&, r]() {
+            std::mt19937 random(100 + r);
+            int xs[BENCH_READS_PER_QUERY], ys[BENCH_READS_PER_QUERY];
+            uint64_t done = 0;
+            while (writing.load(std::memory_order_relaxed))
+            {
+                for (int i = 0; i < BENCH_READS_PER_QUERY; ++i)
+                {
+                    xs[i] = static_cast<int>(random() % BENCH_MAP_WIDTH);
+                    ys[i] = static_cast<int>(random() % BENCH_MAP_HEIGHT);
+                }
+                if (!map.query(xs, ys))
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                done += BENCH_READS_PER_QUERY;
+            }
+            reads.fetch_add(done, std::memory_order_relaxed);
+        });
+    }
+
+    std::mt19937 random(3);
+    int xs[BENCH_TILES_PER_PATCH], ys[BENCH_TILES_PER_PATCH];
+    RunResult result;
+    sf::Clock clock;
+    for (int patch = 0; patch < BENCH_PATCHES; ++patch)
+    {
+        for (int i = 0; i < BENCH_TILES_PER_PATCH; ++i)
+        {
+            xs[i] = static_cast<int>(random() % BENCH_MAP_WIDTH);
+            ys[i] = static_cast<int>(random() % BENCH_MAP_HEIGHT);
+        }
+        map.patch(xs, ys, 10 + patch % 3);
+        if (patch % 256 == 0)
+            result.peakRetired = std::max(result.peakRetired, epochDomain().pendingCount());
+    }
+    const double seconds = clock.getElapsedTime().asSeconds();
+    writing.store(false, std::memory_order_relaxed);
+    for (auto &reader : readers)
+        reader.join();
+
+    result.patchesPerSecond = BENCH_PATCHES / seconds;
+    result.readsPerSecond = static_cast<double>(reads.load()) / seconds;
+    result.tornSnapshots = torn.load();
+    return result;
+}
+
+struct SharedMapAdapter
+{
+    SharedTileMap tiles;
+
+    bool query(const int *xs, const int *ys)
+    {
+        TileReadGuard guard(tiles);
+        const TileMapVersion &version = guard.tiles();
+        int sum = 0;
+        for (int i = 0; i < BENCH_READS_PER_QUERY; ++i)
+            sum += version.at(xs[i], ys[i]);
+        const int stamp = version.at(SENTINELS[0][0], SENTINELS[0][1]);
+        bool consistent = sum >= 0; // Keeps the lookups from being optimized out
+        for (const auto &sentinel : SENTINELS)
+            consistent = consistent && version.at(sentinel[0], sentinel[1]) == stamp;
+        return consistent;
+    }
+
+    void patch(const int *xs, const int *ys, int stamp)
+    {
+        TilePatch patch(tiles);
+        for (int i = 0; i < BENCH_TILES_PER_PATCH; ++i)
+            patch.set(xs[i], ys[i], (xs[i] ^ ys[i]) & 3);
+        for (const auto &sentinel : SENTINELS)
+            patch.set(sentinel[0], sentinel[1], stamp);
+    }
+};
+
+struct LockedGridAdapter
+{
+    TileGrid tiles;
+    std::mutex mutex;
+
+    bool query(const int *xs, const int *ys)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int sum = 0;
+        for (int i = 0; i < BENCH_READS_PER_QUERY; ++i)
+            sum += tiles.at(xs[i], ys[i]);
+        const int stamp = tiles.at(SENTINELS[0][0], SENTINELS[0][1]);
+        bool consistent = sum >= 0; // Keeps the lookups from being optimized out
+        for (const auto &sentinel : SENTINELS)
+            consistent = consistent && tiles.at(sentinel[0], sentinel[1]) == stamp;
+        return consistent;
+    }
+
+    void patch(const int *xs, const int *ys, int stamp)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < BENCH_TILES_PER_PATCH; ++i)
+            tiles.set(xs[i], ys[i], (xs[i] ^ ys[i]) & 3);
+        for (const auto &sentinel : SENTINELS)
+            tiles.set(sentinel[0], sentinel[1], stamp);
+    }
+};
+
+void print(const char *name, const RunResult &result)
+{
+    std::cout << "  " << name << ": " << result.patchesPerSecond << " patches/s, " << result.readsPerSecond / 1e6
+              << " M reads/s";
+    if (result.peakRetired > 0)
+        std::cout << ", peak " << result.peakRetired << " versions awaiting reclamation";
+    std::cout << std::endl;
+}
+} // namespace
+
+int runTileBenchmark()
+{
+    const int readerCount = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    const TileGrid source = makeMap();
+
+    SharedMapAdapter shared;
+    shared.tiles.assign(source);
+    const RunResult sharedAlone = run(shared, 0);
+    const RunResult sharedRead = run(shared, readerCount);
+    const SharedTileMap::Stats stats = shared.tiles.stats();
+
+    LockedGridAdapter locked;
+    locked.tiles = source;
+    const RunResult lockedAlone = run(locked, 0);
+    const RunResult lockedRead = run(locked, readerCount);
+
+    std::cout << "Tile map patches, " << BENCH_MAP_WIDTH << "x" << BENCH_MAP_HEIGHT << " tiles, " << BENCH_PATCHES
+              << " patches of " << BENCH_TILES_PER_PATCH << " tiles, " << readerCount << " reader threads" << std::endl;
+    print("copy-on-write chunks, no readers  ", sharedAlone);
+    print("copy-on-write chunks, with readers", sharedRead);
+    print("one mutex, no readers             ", lockedAlone);
+    print("one mutex, with readers           ", lockedRead);
+    std::cout << "  " << stats.chunksCopied << " chunk copies over " << stats.versionsPublished << " versions"
+              << std::endl;
+
+    epochDomain().collect();
+    const uint64_t torn = sharedRead.tornSnapshots + lockedRead.tornSnapshots;
+    if (torn > 0)
+    {
+        std::cerr << "Tile benchmark: readers saw " << torn << " inconsistent snapshots" << std::endl;
+        return 1;
+    }
+    return 0;
+}
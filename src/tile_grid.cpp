@@ -0,0 +1,234 @@
+#include "tile_grid.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+bool validBits(int bits)
+{
+    return bits == 1 || bits == 2 || bits == 4 || bits == 8 || bits == 16 || bits == 32;
+}
+
+std::size_t wordsPerRow(int width, int bits)
+{
+    return (static_cast<std::size_t>(width) * bits + 63) / 64;
+}
+
+// Fixed index width so the shifts and the per-word tile count fold into constants
+template <int Bits>
+void unpackIndices(const uint64_t *words, const int32_t *palette, int32_t *out, std::size_t count)
+{
+    constexpr int perWord = 64 / Bits;
+    constexpr uint64_t mask = (1ull << Bits) - 1;
+    std::size_t x = 0;
+    for (; x + perWord <= count; x += perWord)
+    {
+        uint64_t word = *words++;
+        for (int i = 0; i < perWord; ++i)
+        {
+            out[x + i] = palette[word & mask];
+            word >>= Bits;
+        }
+    }
+    for (uint64_t word = count > x ? *words : 0; x < count; ++x, word >>= Bits)
+        out[x] = palette[word & mask];
+}
+} // namespace
+
+void TileGrid::reset(int width, int height)
+{
+    gridWidth = std::max(width, 0);
+    gridHeight = std::max(height, 0);
+    bits = 1;
+    mask = 1;
+    rowWords = wordsPerRow(gridWidth, bits);
+    words.assign(rowWords * gridHeight, 0);
+    palette.assign(1, 0);
+    paletteLookup.clear();
+    lastValue = 0;
+    lastIndex = 0;
+}
+
+uint64_t TileGrid::paletteIndex(int value)
+{
+    if (value == lastValue)
+        return lastIndex;
+
+    uint64_t index = palette.size();
+    if (palette.size() <= LINEAR_PALETTE_LIMIT)
+    {
+        index = static_cast<uint64_t>(std::find(palette.begin(), palette.end(), value) - palette.begin());
+    }
+    else
+    {
+        auto it = paletteLookup.find(value);
+        if (it != paletteLookup.end())
+            index = it->second;
+    }
+
+    if (index == palette.size())
+    {
+        palette.push_back(value);
+        if (palette.size() > LINEAR_PALETTE_LIMIT)
+        {
+            if (paletteLookup.empty())
+            {
+                for (std::size_t i = 0; i < palette.size(); ++i)
+                    paletteLookup.emplace(palette[i], i); // First entry wins for duplicates
+            }
+            else
+            {
+                paletteLookup.emplace(value, index);
+            }
+        }
+        if (bits < 32 && index > mask)
+            widen();
+    }
+    lastValue = value;
+    lastIndex = index;
+    return index;
+}
+
+void TileGrid::widen()
+{
+    const int newBits = bits * 2;
+    const std::size_t newRowWords = wordsPerRow(gridWidth, newBits);
+    std::vector<uint64_t> widened(newRowWords * gridHeight, 0);
+    for (int y = 0; y < gridHeight; ++y)
+    {
+        const uint64_t *source = words.data() + static_cast<std::size_t>(y) * rowWords;
+        uint64_t *dest = widened.data() + static_cast<std::size_t>(y) * newRowWords;
+        for (int x = 0; x < gridWidth; ++x)
+        {
+            const std::size_t oldBit = static_cast<std::size_t>(x) * bits;
+            const std::size_t newBit = static_cast<std::size_t>(x) * newBits;
+            const uint64_t index = (source[oldBit >> 6] >> (oldBit & 63)) & mask;
+            dest[newBit >> 6] |= index << (newBit & 63);
+        }
+    }
+    words.swap(widened);
+    rowWords = newRowWords;
+    bits = newBits;
+    mask = (1ull << bits) - 1;
+}
+
+void TileGrid::set(int x, int y, int value)
+{
+    const uint64_t index = paletteIndex(value); // May widen, so read the layout after
+    const std::size_t bit = static_cast<std::size_t>(x) * bits;
+    uint64_t &word = words[static_cast<std::size_t>(y) * rowWords + (bit >> 6)];
+    word = (word & ~(mask << (bit & 63))) | (index << (bit & 63));
+}
+
+void TileGrid::setRow(int y, int firstX, const int32_t *values, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+        set(firstX + static_cast<int>(i), y, values[i]);
+}
+
+void TileGrid::unpackRow(int y, int32_t *out) const
+{
+    const uint64_t *row = words.data() + static_cast<std::size_t>(y) * rowWords;
+    const std::size_t count = static_cast<std::size_t>(gridWidth);
+    switch (bits)
+    {
+    case 1:
+        unpackIndices<1>(row, palette.data(), out, count);
+        break;
+    case 2:
+        unpackIndices<2>(row, palette.data(), out, count);
+        break;
+    case 4:
+        unpackIndices<4>(row, palette.data(), out, count);
+        break;
+    case 8:
+        unpackIndices<8>(row, palette.data(), out, count);
+        break;
+    case 16:
+        unpackIndices<16>(row, palette.data(), out, count);
+        break;
+    default:
+        unpackIndices<32>(row, palette.data(), out, count);
+        break;
+    }
+}
+
+// --- Wire format ---
+
+void TileGrid::write(sf::Packet &packet) const
+{
+    packet << static_cast<uint32_t>(gridWidth) << static_cast<uint32_t>(gridHeight) << static_cast<uint8_t>(bits)
+           << static_cast<uint32_t>(palette.size());
+    writeArray(packet, palette.data(), palette.size());
+
+    const std::size_t rowBytes = (static_cast<std::size_t>(gridWidth) * bits + 7) / 8;
+    std::vector<uint8_t> row(rowBytes);
+    for (int y = 0; y < gridHeight; ++y)
+    {
+        const uint64_t *source = words.data() + static_cast<std::size_t>(y) * rowWords;
+        for (std::size_t i = 0; i < rowBytes; ++i)
+            row[i] = static_cast<uint8_t>(source[i >> 3] >> ((i & 7) * 8));
+        writeArray(packet, row.data(), row.size());
+    }
+}
+
+bool TileGrid::read(ByteReader &reader)
+{
+    uint32_t width, height, paletteCount;
+    uint8_t indexBits;
+    if (!(reader >> width >> height >> indexBits >> paletteCount) || !validBits(indexBits) || paletteCount == 0 ||
+        width > static_cast<uint32_t>(std::numeric_limits<int>::max()) ||
+        height > static_cast<uint32_t>(std::numeric_limits<int>::max()) ||
+        (indexBits < 32 && paletteCount > (1u << indexBits)))
+        return false;
+
+    // Check the sizes against what is left before allocating anything
+    const std::size_t rowBytes = (static_cast<std::size_t>(width) * indexBits + 7) / 8;
+    if (reader.remaining() / sizeof(int32_t) < paletteCount ||
+        (rowBytes > 0 && (reader.remaining() - paletteCount * sizeof(int32_t)) / rowBytes < height))
+        return false;
+
+    std::vector<int32_t> values(paletteCount);
+    reader.readArray(values.data(), values.size());
+
+    const std::size_t stride = wordsPerRow(static_cast<int>(width), indexBits);
+    std::vector<uint64_t> packed(stride * height, 0);
+    std::vector<uint8_t> row(rowBytes);
+    const uint64_t indexMask = (1ull << indexBits) - 1;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        if (!reader.readArray(row.data(), row.size()))
+            return false;
+        uint64_t *dest = packed.data() + static_cast<std::size_t>(y) * stride;
+        for (std::size_t i = 0; i < rowBytes; ++i)
+            dest[i >> 3] |= static_cast<uint64_t>(row[i]) << ((i & 7) * 8);
+
+        // Every index must name a palette entry
+        if (indexBits == 32 || paletteCount < (1u << indexBits))
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const std::size_t bit = static_cast<std::size_t>(x) * indexBits;
+                if (((dest[bit >> 6] >> (bit & 63)) & indexMask) >= paletteCount)
+                    return false;
+            }
+        }
+    }
+
+    gridWidth = static_cast<int>(width);
+    gridHeight = static_cast<int>(height);
+    bits = indexBits;
+    mask = indexMask;
+    rowWords = stride;
+    words.swap(packed);
+    palette.swap(values);
+    paletteLookup.clear();
+    if (palette.size() > LINEAR_PALETTE_LIMIT)
+    {
+        for (std::size_t i = 0; i < palette.size(); ++i)
+            paletteLookup.emplace(palette[i], i); // First entry wins for duplicates
+    }
+    lastValue = palette[0];
+    lastIndex = 0;
+    return true;
+}
@@ -0,0 +1,125 @@
+#include "tile_report.hpp"
+#include "byte_codec.hpp"
+#include "protocol.hpp"
+#include "replay.hpp"
+#include "tile_grid.hpp"
+#include <SFML/System.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+struct MapSizes
+{
+    std::size_t maps = 0;
+    uint64_t tiles = 0;
+    uint64_t unpackedBytes = 0; // One int32 per tile, as clientTileMap used to hold them
+    uint64_t packedBytes = 0;
+    uint64_t mapDataBytes = 0;
+    uint64_t packedMapDataBytes = 0;
+};
+
+// Raw MapData rows into a grid
+bool readMapData(sf::Packet &packet, TileGrid &tiles)
+{
+    uint32_t width, height;
+    if (!(packet >> width >> height))
+        return false;
+    ByteReader reader(packet);
+    if (reader.remaining() / sizeof(int32_t) / std::max<uint32_t>(width, 1) < height)
+        return false;
+    tiles.reset(static_cast<int>(width), static_cast<int>(height));
+    std::vector<int32_t> row(width);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        reader.readArray(row.data(), row.size());
+        tiles.setRow(static_cast<int>(y), 0, row.data(), row.size());
+    }
+    return true;
+}
+
+double percentSaved(uint64_t before, uint64_t after)
+{
+    return before > 0 ? 100.0 * (1.0 - static_cast<double>(after) / static_cast<double>(before)) : 0.0;
+}
+
+void reportMap(const TileGrid &tiles, MapSizes &totals)
+{
+    const uint64_t count = static_cast<uint64_t>(tiles.width()) * static_cast<uint64_t>(tiles.height());
+    const uint64_t unpacked = count * sizeof(int32_t);
+    const uint64_t mapData = 1 + 2 * sizeof(uint32_t) + unpacked;
+
+    sf::Packet packed;
+    packed << PacketType::PackedMapData;
+    tiles.write(packed);
+
+    // Unpacking every row is what rendering and the map hash do on load
+    std::vector<int32_t> row(tiles.width());
+    sf::Clock clock;
+    for (int y = 0; y < tiles.height(); ++y)
+        tiles.unpackRow(y, row.data());
+    const double seconds = clock.getElapsedTime().asSeconds();
+
+    std::cout << "  " << tiles.width() << "x" << tiles.height() << ", " << tiles.paletteSize() << " values at "
+              << tiles.bitsPerTile() << " bits: memory " << unpacked << " -> " << tiles.memoryBytes() << " bytes ("
+              << percentSaved(unpacked, tiles.memoryBytes()) << "% saved), wire " << mapData << " -> "
+              << packed.getDataSize() << " bytes (" << percentSaved(mapData, packed.getDataSize())
+              << "% saved), unpack " << (seconds > 0.0 ? static_cast<double>(count) / seconds / 1e6 : 0.0)
+              << " M tiles/s" << std::endl;
+
+    ++totals.maps;
+    totals.tiles += count;
+    totals.unpackedBytes += unpacked;
+    totals.packedBytes += tiles.memoryBytes();
+    totals.mapDataBytes += mapData;
+    totals.packedMapDataBytes += packed.getDataSize();
+}
+} // namespace
+
+int runTileReport(const std::vector<std::string> &capturePaths)
+{
+    MapSizes totals;
+    for (const auto &path : capturePaths)
+    {
+        ReplayReader reader;
+        if (!reader.open(path))
+            continue;
+        std::cout << path << std::endl;
+
+        // Keyframes repeat the map the messages delivered, so only messages count
+        ReplayRecord record;
+        reader.rewind();
+        while (reader.readRecord(record))
+        {
+            PacketType type;
+            if (record.kind != ReplayRecordKind::Message || !(record.packet >> type))
+                continue;
+
+            TileGrid tiles;
+            bool valid = false;
+            if (type == PacketType::MapData)
+            {
+                valid = readMapData(record.packet, tiles);
+            }
+            else if (type == PacketType::PackedMapData)
+            {
+                ByteReader packedReader(record.packet);
+                valid = tiles.read(packedReader);
+            }
+            if (valid)
+                reportMap(tiles, totals);
+        }
+    }
+
+    if (totals.maps == 0)
+    {
+        std::cerr << "No maps found in the given captures" << std::endl;
+        return 1;
+    }
+    std::cout << "Total: " << totals.maps << " maps, " << totals.tiles << " tiles" << std::endl;
+    std::cout << "  memory " << totals.unpackedBytes << " -> " << totals.packedBytes << " bytes ("
+              << percentSaved(totals.unpackedBytes, totals.packedBytes) << "% saved)" << std::endl;
+    std::cout << "  wire " << totals.mapDataBytes << " -> " << totals.packedMapDataBytes << " bytes ("
+              << percentSaved(totals.mapDataBytes, totals.packedMapDataBytes) << "% saved)" << std::endl;
+    return 0;
+}